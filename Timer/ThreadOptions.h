@@ -0,0 +1,100 @@
+#pragma once
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <system_error>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Placement and scheduling options for the threads owned by the timers (the TimerScheduler dispatch thread, the
+ * TimerCb thread). Every field defaults to "leave as is". E.g.,
+ *
+ *   ThreadOptions options;
+ *   options.cpus = {3};
+ *   options.schedPolicy = SCHED_FIFO;
+ *   options.schedPriority = 10;
+ *   options.name = "timer-dispatch";
+ *   scheduler.setThreadOptions(options);
+ *   scheduler.start(); // throws std::system_error if any option can't be applied
+ *
+ * Only supported on Linux, elsewhere applying any option fails with std::errc::not_supported.
+ */
+struct ThreadOptions
+{
+    static constexpr int kUnchanged = INT_MIN;
+
+    std::vector<int> cpus;            // CPUs the thread may run on. Empty keeps the inherited affinity.
+    int schedPolicy{kUnchanged};      // SCHED_OTHER, SCHED_FIFO, SCHED_RR, ...
+    int schedPriority{0};             // Static priority, used together with schedPolicy (1..99 for SCHED_FIFO/SCHED_RR).
+    int niceLevel{kUnchanged};        // Nice level of the thread, -20..19.
+    std::string name;                 // Thread name, at most 15 characters on Linux.
+    size_t numaLocalReserve{0};       // Number of timers to preallocate storage for from the pinned thread, so that
+                                      // it is placed on its NUMA node by first-touch. 0 disables it.
+};
+
+/**
+ * Applies options to the calling thread. Returns an empty error_code on success, otherwise the error of the first
+ * option that failed; options after it are not applied.
+ */
+inline std::error_code applyThreadOptions(const ThreadOptions &options)
+{
+    // numaLocalReserve is handled by the owner of the storage, not here.
+    if (options.cpus.empty() && options.schedPolicy == ThreadOptions::kUnchanged &&
+        options.niceLevel == ThreadOptions::kUnchanged && options.name.empty())
+    {
+        return {};
+    }
+#ifdef __linux__
+    if (!options.cpus.empty())
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu : options.cpus)
+        {
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+            {
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+            CPU_SET(cpu, &cpuset);
+        }
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset))
+        {
+            return std::error_code(err, std::system_category());
+        }
+    }
+    if (options.schedPolicy != ThreadOptions::kUnchanged)
+    {
+        sched_param param{};
+        param.sched_priority = options.schedPriority;
+        if (int err = pthread_setschedparam(pthread_self(), options.schedPolicy, &param))
+        {
+            return std::error_code(err, std::system_category());
+        }
+    }
+    if (options.niceLevel != ThreadOptions::kUnchanged)
+    {
+        // On Linux the nice level is a per-thread attribute, addressed by the thread id.
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.niceLevel) != 0)
+        {
+            return std::error_code(errno, std::system_category());
+        }
+    }
+    if (!options.name.empty())
+    {
+        if (int err = pthread_setname_np(pthread_self(), options.name.c_str()))
+        {
+            return std::error_code(err, std::system_category());
+        }
+    }
+    return {};
+#else
+    return std::make_error_code(std::errc::not_supported);
+#endif
+}
@@ -1,5 +1,6 @@
 
 #include "TimerCb.h"
+#include <future>
 
 TimerCb::TimerCb() : is_running(false)
 {
@@ -17,9 +18,16 @@ void TimerCb::start(int interval_ms, std::function<void()> callback)
         return; // 如果定时器已经在运行,返回,代表该定时器对象已经在运行,不需要再启动了
 
     is_running = true; // 设置定时器运行状态
-    // 创建定时器线程
-    thread_ = std::thread([this, interval_ms, callback]()
+    // 创建定时器线程,线程先把线程选项应用到自己身上,再把结果告诉start
+    std::promise<std::error_code> applied;
+    std::future<std::error_code> applied_result = applied.get_future();
+    thread_ = std::thread([this, interval_ms, callback, applied = std::move(applied)]() mutable
                           {
+        std::error_code ec = applyThreadOptions(options_);
+        applied.set_value(ec);
+        if (ec) {
+            return; //设置失败,线程直接退出,由start抛出异常
+        }
         while (is_running) { //如果定时器是运行状态
             //这里要说一下,下面使用了互斥锁和条件变量, 因为条件变量需要和互斥锁一起使用,大家知道使用条件变量需要
             //三个操作,先抢锁,等待条件,条件满足解锁,程序往下执行,这里的条件变量等待的条件就是interval_ms时间,这个
@@ -32,6 +40,20 @@ void TimerCb::start(int interval_ms, std::function<void()> callback)
                 callback(); //调用回调
             }
         } });
+
+    std::error_code ec = applied_result.get();
+    if (ec)
+    { // 设置失败,回收线程,定时器回到未运行状态
+        is_running = false;
+        thread_.join();
+        throw std::system_error(ec, "TimerCb: failed to apply thread options");
+    }
+}
+
+// 设置线程选项,只在start之前调用才安全
+void TimerCb::setThreadOptions(const ThreadOptions &options)
+{
+    options_ = options;
 }
 
 // 结束定时器
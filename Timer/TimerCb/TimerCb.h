@@ -6,12 +6,14 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include "../ThreadOptions.h"
 /**************************************
 From 只讲干货的攻城狮 :2023/08/18
 TimerCb: c++实现一个定时器回调类
 //https://zhuanlan.zhihu.com/p/650930845
 start用来启动定时器
 stop 用来终止定时器
+setThreadOptions 用来设置定时器线程的CPU亲和性、调度策略、nice值和线程名
 ***********************************************/
 
 class TimerCb
@@ -19,11 +21,13 @@ class TimerCb
 public:
     TimerCb();
     ~TimerCb();
-    void start(int interval_ms, std::function<void()> callback); // 启动定时器
+    void start(int interval_ms, std::function<void()> callback); // 启动定时器,线程选项设置失败时抛出std::system_error
     void stop();                                                 // 停止定时器
+    void setThreadOptions(const ThreadOptions &options);         // 设置线程选项,需要在start之前调用
 private:
     std::atomic<bool> is_running; // 是否在运行
     std::thread thread_;          // 定时器线程
     std::mutex mutex_;            // 互斥锁
     std::condition_variable cv_;  // 条件变量
+    ThreadOptions options_;       // 线程选项
 };
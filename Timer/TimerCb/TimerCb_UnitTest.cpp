@@ -82,6 +82,66 @@ TEST(TimerCbTest, TimerCallsCallbackWithParam)
     EXPECT_GT(call_count, 0); // 确保回调至少被调用了一次
 }
 
+#ifdef __linux__
+// 取一个当前线程允许运行的CPU，不能假设CPU 0在cpuset里
+static int allowedCpu()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+                return cpu;
+        }
+    }
+    return 0;
+}
+
+// 测试定时器线程的CPU亲和性和线程名
+TEST(TimerCbTest, TimerThreadOptions)
+{
+    TimerCb timer;
+    ThreadOptions options;
+    const int allowed = allowedCpu();
+    options.cpus = {allowed};
+    options.name = "timer-cb";
+    timer.setThreadOptions(options);
+
+    std::mutex mutex;
+    int cpu = -1;
+    char name[16] = {0};
+    timer.start(50, [&]()
+                {
+        std::lock_guard<std::mutex> lock(mutex);
+        cpu = sched_getcpu();
+        pthread_getname_np(pthread_self(), name, sizeof(name)); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    timer.stop();
+
+    EXPECT_EQ(cpu, allowed);
+    EXPECT_STREQ(name, "timer-cb");
+}
+
+// 测试线程选项设置失败时start抛出异常
+TEST(TimerCbTest, TimerThreadOptionsFailure)
+{
+    TimerCb timer;
+    ThreadOptions options;
+    options.name = "a-thread-name-that-is-too-long";
+    timer.setThreadOptions(options);
+
+    bool callback_called = false;
+    EXPECT_THROW(timer.start(10, [&]()
+                             { callback_called = true; }),
+                 std::system_error);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(callback_called);
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,79 @@
+#include "PerfCounter.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+PerfCounter::PerfCounter(Event event)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (event)
+    {
+    case CacheMisses:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case CacheReferences:
+        attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+        break;
+    case Instructions:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    }
+    attr.disabled = 1;
+    attr.exclude_kernel = 1; // 没有权限时也能只统计用户态
+    attr.exclude_hv = 1;
+    // 只统计当前线程,在任意CPU上
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounter::~PerfCounter()
+{
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+void PerfCounter::start()
+{
+    if (fd_ < 0)
+        return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+uint64_t PerfCounter::stop()
+{
+    if (fd_ < 0)
+        return 0;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count = 0;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count))
+        return 0;
+    return count;
+}
+
+#else
+
+PerfCounter::PerfCounter(Event)
+{
+}
+
+PerfCounter::~PerfCounter()
+{
+}
+
+void PerfCounter::start()
+{
+}
+
+uint64_t PerfCounter::stop()
+{
+    return 0;
+}
+
+#endif
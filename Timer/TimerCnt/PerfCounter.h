@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+/**************************************
+PerfCounter: 用perf_event_open读取当前线程的硬件计数器,默认是缓存未命中次数
+计时只能说明变快了,配合缓存未命中次数才能说明为什么变快。
+容器里、虚拟机里或者perf_event_paranoid不允许时打不开计数器,此时available()返回false,stop()返回0,
+调用方只打印计时结果即可。非Linux平台上始终不可用。
+
+    PerfCounter misses;
+    misses.start();
+    ...
+    uint64_t n = misses.stop();
+***********************************************/
+
+class PerfCounter
+{
+public:
+    enum Event
+    {
+        CacheMisses,       // 最后一级缓存未命中
+        CacheReferences,   // 最后一级缓存访问
+        Instructions,      // 执行的指令数
+    };
+
+    explicit PerfCounter(Event event = CacheMisses);
+    ~PerfCounter();
+
+    PerfCounter(const PerfCounter &) = delete;
+    PerfCounter &operator=(const PerfCounter &) = delete;
+
+    bool available() const { return fd_ >= 0; }
+
+    // 清零并开始计数
+    void start();
+
+    // 停止计数,返回从start开始的事件次数
+    uint64_t stop();
+
+private:
+    int fd_ = -1;
+};
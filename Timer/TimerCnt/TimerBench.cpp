@@ -0,0 +1,134 @@
+#include "TimerBench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    // 已排序样本的中位数
+    double medianOf(const std::vector<double> &sorted)
+    {
+        if (sorted.empty())
+            return 0;
+        size_t n = sorted.size();
+        return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+
+    double madOf(const std::vector<double> &sorted, double median)
+    {
+        std::vector<double> deviations;
+        deviations.reserve(sorted.size());
+        for (double x : sorted)
+            deviations.push_back(std::fabs(x - median));
+        std::sort(deviations.begin(), deviations.end());
+        return medianOf(deviations);
+    }
+
+    // 最近秩法求百分位数
+    double percentileOf(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        size_t rank = size_t(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+}
+
+TimerBench::TimerBench(BenchOptions options) : options_(options)
+{
+}
+
+BenchResult TimerBench::summarize(const std::string &name, uint64_t iterations, std::vector<double> samples) const
+{
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    std::sort(samples.begin(), samples.end());
+
+    // 剔除离群值:1.4826 * MAD是正态分布下标准差的稳健估计
+    double median = medianOf(samples);
+    double mad = madOf(samples, median);
+    if (mad > 0)
+    {
+        double limit = options_.outlierK * 1.4826 * mad;
+        size_t before = samples.size();
+        samples.erase(std::remove_if(samples.begin(), samples.end(), [&](double x)
+                                     { return std::fabs(x - median) > limit; }),
+                      samples.end());
+        result.outliers = before - samples.size();
+        median = medianOf(samples);
+        mad = madOf(samples, median);
+    }
+
+    result.samples = std::move(samples);
+    result.median = median;
+    result.mad = mad;
+    result.p99 = percentileOf(result.samples, 99);
+    result.throughput = median > 0 ? 1e9 / median : 0;
+    return result;
+}
+
+BenchComparison TimerBench::compare(const BenchResult &baseline, const BenchResult &candidate) const
+{
+    BenchComparison comparison;
+    comparison.baseline = baseline.name;
+    comparison.candidate = candidate.name;
+    comparison.ratio = baseline.median > 0 ? candidate.median / baseline.median : 0;
+
+    // Mann-Whitney U检验:不假设正态分布,对计时数据里常见的长尾更稳健。样本足够多时用正态近似
+    const double n1 = baseline.samples.size(), n2 = candidate.samples.size();
+    if (n1 == 0 || n2 == 0)
+        return comparison;
+
+    // 合并排序求秩,相同的值取平均秩,同时累计用于修正方差的ties项
+    std::vector<std::pair<double, int>> all;
+    for (double x : baseline.samples)
+        all.emplace_back(x, 0);
+    for (double x : candidate.samples)
+        all.emplace_back(x, 1);
+    std::sort(all.begin(), all.end());
+
+    double rankSum1 = 0, ties = 0;
+    for (size_t i = 0; i < all.size();)
+    {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first)
+            ++j;
+        double rank = (i + 1 + j) / 2.0;
+        double t = double(j - i);
+        ties += t * t * t - t;
+        for (size_t k = i; k < j; ++k)
+            if (all[k].second == 0)
+                rankSum1 += rank;
+        i = j;
+    }
+
+    const double n = n1 + n2;
+    const double u1 = rankSum1 - n1 * (n1 + 1) / 2;
+    const double mean = n1 * n2 / 2;
+    const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if (variance > 0)
+    {
+        // 连续性修正
+        double z = (std::fabs(u1 - mean) - 0.5) / std::sqrt(variance);
+        z = std::max(z, 0.0);
+        comparison.pValue = std::erfc(z / std::sqrt(2.0));
+    }
+    comparison.significant = comparison.pValue < options_.alpha;
+    comparison.regression = comparison.significant && comparison.ratio > 1 + options_.minEffect;
+    return comparison;
+}
+
+void TimerBench::print(const BenchResult &result)
+{
+    std::printf("%-24s median %12.2f ns  MAD %10.2f ns  p99 %12.2f ns  %14.0f ops/s  (%zu samples x %llu iters, %zu outliers)\n",
+                result.name.c_str(), result.median, result.mad, result.p99, result.throughput,
+                result.samples.size(), (unsigned long long)result.iterations, result.outliers);
+}
+
+void TimerBench::print(const BenchComparison &comparison)
+{
+    std::printf("%s vs %s: %.3fx, p = %.4g%s%s\n", comparison.candidate.c_str(), comparison.baseline.c_str(),
+                comparison.ratio, comparison.pValue, comparison.significant ? " (significant)" : "",
+                comparison.regression ? " REGRESSION" : "");
+}
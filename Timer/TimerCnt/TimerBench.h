@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "TimerCnt.h"
+
+/**************************************
+TimerBench: 基于TimerCnt的统计型微基准测试
+单次TimerCnt计时受噪声影响很大,没法用来比较优化前后的差别。TimerBench的流程:
+1. 预热warmup次,不计入结果
+2. 自动调整每次采样的迭代次数,使一次采样大约耗时targetTime
+3. 采样repetitions次,每次用TimerCnt计时,得到每次迭代的耗时
+4. 用中位数和MAD剔除离群值,报告中位数、MAD、p99和吞吐量
+compare用Mann-Whitney U检验比较两组结果,判断差别是否显著、是否是性能回退
+
+    TimerBench bench;
+    BenchResult a = bench.run("quickSort", [&] { ... });
+    BenchResult b = bench.run("std::sort", [&] { ... });
+    TimerBench::print(a);
+    TimerBench::print(bench.compare(a, b));
+***********************************************/
+
+struct BenchOptions
+{
+    int warmup = 3;                                                       // 预热次数
+    int repetitions = 30;                                                 // 采样次数
+    std::chrono::nanoseconds targetTime = std::chrono::milliseconds(10); // 每次采样的目标耗时
+    uint64_t maxIterations = uint64_t(1) << 30;                           // 每次采样的迭代次数上限
+    double outlierK = 3.0;                                                // 偏离中位数超过outlierK倍MAD(已换算成标准差)的样本视为离群值
+    double alpha = 0.01;                                                  // 显著性水平
+    double minEffect = 0.02;                                              // 中位数相差不到2%时不算回退,避免把微小的差别当成回退
+};
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;     // 每次采样的迭代次数
+    std::vector<double> samples; // 剔除离群值以后每次迭代的耗时(ns),从小到大排序
+    size_t outliers = 0;         // 剔除的离群值个数
+    double median = 0;           // ns
+    double mad = 0;              // 中位数绝对偏差,ns
+    double p99 = 0;              // ns
+    double throughput = 0;       // 每秒迭代次数
+};
+
+struct BenchComparison
+{
+    std::string baseline, candidate;
+    double ratio = 0;         // candidate中位数 / baseline中位数,大于1表示变慢
+    double pValue = 1;        // 双侧Mann-Whitney U检验的p值
+    bool significant = false; // pValue < alpha
+    bool regression = false;  // 显著且变慢超过minEffect
+};
+
+// 防止编译器把基准测试里的计算优化掉
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+class TimerBench
+{
+public:
+    explicit TimerBench(BenchOptions options = BenchOptions());
+
+    // 对fn做基准测试,fn有返回值时会经过doNotOptimize,fn里的中间结果可以自己调用doNotOptimize
+    template <typename Fn>
+    BenchResult run(const std::string &name, Fn &&fn);
+
+    // 比较两组结果,candidate相对baseline
+    BenchComparison compare(const BenchResult &baseline, const BenchResult &candidate) const;
+
+    // 根据原始样本(每次迭代的耗时,ns)计算统计量并剔除离群值
+    BenchResult summarize(const std::string &name, uint64_t iterations, std::vector<double> samples) const;
+
+    static void print(const BenchResult &result);
+    static void print(const BenchComparison &comparison);
+
+private:
+    template <typename Fn>
+    static std::chrono::nanoseconds timeIterations(Fn &fn, uint64_t iterations);
+
+    // 调用一次fn,有返回值时经过doNotOptimize
+    template <typename Fn>
+    static void invoke(Fn &fn)
+    {
+        invoke(fn, std::is_void<decltype(fn())>());
+    }
+    template <typename Fn>
+    static void invoke(Fn &fn, std::true_type)
+    {
+        fn();
+    }
+    template <typename Fn>
+    static void invoke(Fn &fn, std::false_type)
+    {
+        doNotOptimize(fn());
+    }
+
+    BenchOptions options_;
+};
+
+template <typename Fn>
+std::chrono::nanoseconds TimerBench::timeIterations(Fn &fn, uint64_t iterations)
+{
+    TimerCnt timer(false);
+    for (uint64_t i = 0; i < iterations; ++i)
+    {
+        invoke(fn);
+    }
+    return timer.elapsed();
+}
+
+template <typename Fn>
+BenchResult TimerBench::run(const std::string &name, Fn &&fn)
+{
+    // 预热:填充缓存、分支预测器,触发惰性初始化
+    for (int i = 0; i < options_.warmup; ++i)
+    {
+        invoke(fn);
+    }
+
+    // 迭代次数翻倍,直到一次采样的耗时足够长,再按比例估算到targetTime
+    uint64_t iterations = 1;
+    std::chrono::nanoseconds elapsed = timeIterations(fn, iterations);
+    while (elapsed < options_.targetTime / 10 && iterations < options_.maxIterations)
+    {
+        iterations *= 2;
+        elapsed = timeIterations(fn, iterations);
+    }
+    if (elapsed.count() > 0 && elapsed < options_.targetTime)
+    {
+        const double scale = double(options_.targetTime.count()) / double(elapsed.count());
+        iterations = std::min<uint64_t>(options_.maxIterations, uint64_t(double(iterations) * scale));
+    }
+    iterations = std::max<uint64_t>(iterations, 1);
+
+    std::vector<double> samples;
+    samples.reserve(options_.repetitions);
+    for (int i = 0; i < options_.repetitions; ++i)
+    {
+        samples.push_back(double(timeIterations(fn, iterations).count()) / double(iterations));
+    }
+    return summarize(name, iterations, std::move(samples));
+}
@@ -1,14 +1,21 @@
 #include "TimerCnt.h"
 
-TimerCnt::TimerCnt()
+TimerCnt::TimerCnt(bool printOnExit) : print(printOnExit)
 {
     start = std::chrono::high_resolution_clock::now();
 }
 
 TimerCnt::~TimerCnt()
 {
+    if (!print)
+        return;
     end = std::chrono::high_resolution_clock::now();
     duration = end - start;
     float ms = duration.count() * 1000.0f;
     std::cout << "Timer took " << ms << "ms" << std::endl;
 }
+
+std::chrono::nanoseconds TimerCnt::elapsed() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start);
+}
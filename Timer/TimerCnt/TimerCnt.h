@@ -1,3 +1,4 @@
+#pragma once
 #include <iostream>
 #include <thread>
 #include <chrono> // 适用于多种平台
@@ -7,9 +8,13 @@ class TimerCnt
 private:
     std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
     std::chrono::duration<float> duration;
+    bool print; // 析构时是否打印耗时
 
 public:
-    TimerCnt();
+    explicit TimerCnt(bool printOnExit = true);
 
     ~TimerCnt();
-};
\ No newline at end of file
+
+    // 从构造到现在经过的时间,可以在不打印的情况下读取,TimerBench用它来采样
+    std::chrono::nanoseconds elapsed() const;
+};
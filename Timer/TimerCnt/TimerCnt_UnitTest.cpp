@@ -1,4 +1,6 @@
 #include "TimerCnt.h"
+#include "TimerBench.h"
+#include "PerfCounter.h"
 #include "stdio.h"
 #include <gtest/gtest.h>
 #include <vector>
@@ -54,6 +56,79 @@ TEST(QuickSortTest, SortsLargeArray)
 
     // EXPECT_TRUE(std::is_sorted(arr.begin(), arr.end()));
 }
+// 测试统计量的计算和离群值剔除
+TEST(TimerBenchTest, Statistics)
+{
+    TimerBench bench;
+    BenchResult result = bench.summarize("samples", 1, {10, 11, 9, 10, 10, 12, 8, 10, 1000});
+    EXPECT_EQ(result.outliers, 1u);
+    EXPECT_EQ(result.samples.size(), 8u);
+    EXPECT_DOUBLE_EQ(result.median, 10);
+    EXPECT_DOUBLE_EQ(result.mad, 0.5);
+    EXPECT_DOUBLE_EQ(result.p99, 12);
+    EXPECT_DOUBLE_EQ(result.throughput, 1e8);
+
+    BenchResult same = bench.summarize("same", 1, {10, 11, 9, 10, 10, 12, 8, 10});
+    BenchComparison noChange = bench.compare(result, same);
+    EXPECT_FALSE(noChange.significant);
+    EXPECT_FALSE(noChange.regression);
+
+    BenchResult slower = bench.summarize("slower", 1, {20, 21, 19, 20, 20, 22, 18, 20});
+    BenchComparison regression = bench.compare(result, slower);
+    TimerBench::print(regression);
+    EXPECT_DOUBLE_EQ(regression.ratio, 2);
+    EXPECT_TRUE(regression.significant);
+    EXPECT_TRUE(regression.regression);
+    EXPECT_FALSE(bench.compare(slower, result).regression); // 变快不算回退
+}
+
+// 用基准测试模式比较不同规模的快速排序
+TEST(TimerBenchTest, QuickSort)
+{
+    BenchOptions options;
+    options.repetitions = 15;
+    options.targetTime = std::chrono::milliseconds(2);
+    TimerBench bench(options);
+
+    std::vector<int> small(1000), large(4000), v;
+    for (auto &x : small)
+        x = rand() % 100000;
+    for (auto &x : large)
+        x = rand() % 100000;
+
+    BenchResult smallResult = bench.run("quickSort 1000", [&]
+                                        { v = small; quickSort(v, 0, v.size() - 1); return v[0]; });
+    BenchResult largeResult = bench.run("quickSort 4000", [&]
+                                        { v = large; quickSort(v, 0, v.size() - 1); return v[0]; });
+    TimerBench::print(smallResult);
+    TimerBench::print(largeResult);
+    BenchComparison comparison = bench.compare(smallResult, largeResult);
+    TimerBench::print(comparison);
+
+    EXPECT_GT(smallResult.iterations, 1u);
+    EXPECT_LE(smallResult.median, smallResult.p99);
+    EXPECT_GT(smallResult.throughput, largeResult.throughput);
+    EXPECT_TRUE(comparison.regression);
+}
+
+// 测试硬件计数器,没有权限打开计数器时退化为返回0
+TEST(PerfCounterTest, Instructions)
+{
+    PerfCounter counter(PerfCounter::Instructions);
+    std::vector<int> v(10000);
+    for (auto &x : v)
+        x = rand() % 100000;
+
+    counter.start();
+    quickSort(v, 0, v.size() - 1);
+    uint64_t instructions = counter.stop();
+
+    if (counter.available())
+        EXPECT_GT(instructions, 10000u);
+    else
+        EXPECT_EQ(instructions, 0u);
+}
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "TimerScheduler.h"
+
+/**
+ * Coalesces bursts of trigger() calls into a single call of cb, made once no trigger() happened for delay. E.g.,
+ *
+ *   TimerScheduler fs;
+ *   Debouncer reload(fs, [&] { reloadConfig(); }, seconds(1), "reloadConfig");
+ *   fs.start();
+ *   ........
+ *   reload.trigger(); // on every config change event
+ *
+ * The debouncer owns one idle function in the scheduler (see addIdleFunction()), which is armed when a burst starts
+ * and rearmed in place while the burst goes on. With a locking scheduler (e.g. TimerScheduler) trigger() may be
+ * called from any thread; it is a single atomic exchange unless it starts a new burst. A thread-less scheduler
+ * (LoopTimerScheduler, NullMutex) is not thread-safe, so trigger() must then be called from the thread that calls
+ * runExpired(). cb runs in the thread that runs the scheduler's functions.
+ */
+template <typename Scheduler>
+class BasicDebouncer
+{
+public:
+    using Clock = typename Scheduler::ClockType;
+
+    BasicDebouncer(Scheduler &scheduler, std::function<void()> cb, std::chrono::microseconds delay, std::string nameID)
+        : scheduler_(scheduler), cb_(std::move(cb)), delay_(delay), name_(std::move(nameID))
+    {
+        if (delay_ < std::chrono::microseconds::zero())
+        {
+            throw std::invalid_argument("Debouncer: delay must be non-negative");
+        }
+        scheduler_.addIdleFunction([this]
+                                   { onTimer(); }, name_);
+    }
+
+    ~BasicDebouncer()
+    {
+        scheduler_.cancelFunctionAndWait(name_);
+    }
+
+    BasicDebouncer(const BasicDebouncer &) = delete;
+    BasicDebouncer &operator=(const BasicDebouncer &) = delete;
+
+    // Pushes the call of cb back to delay from now.
+    void trigger()
+    {
+        const int64_t deadline = toTicks(Clock::now() + delay_);
+        if (deadline_.exchange(deadline, std::memory_order_acq_rel) == kIdle)
+        {
+            // First trigger of a burst.
+            scheduler_.armFunction(name_, delay_);
+        }
+    }
+
+private:
+    static constexpr int64_t kIdle = std::numeric_limits<int64_t>::min();
+
+    static int64_t toTicks(typename Clock::time_point t)
+    {
+        return std::chrono::duration_cast<typename Clock::duration>(t.time_since_epoch()).count();
+    }
+
+    void onTimer()
+    {
+        int64_t deadline = deadline_.load(std::memory_order_acquire);
+        while (true)
+        {
+            const auto now = Clock::now();
+            if (deadline > toTicks(now))
+            {
+                // Triggered again since we were armed, sleep for the rest of the quiet period.
+                const typename Clock::duration left(deadline - toTicks(now));
+                auto wait = std::chrono::duration_cast<std::chrono::microseconds>(left);
+                if (wait < left)
+                {
+                    wait += std::chrono::microseconds(1);
+                }
+                scheduler_.armFunction(name_, wait);
+                return;
+            }
+            if (deadline_.compare_exchange_weak(deadline, kIdle, std::memory_order_acq_rel))
+            {
+                break;
+            }
+        }
+        // A trigger() from now on starts a new burst, which arms us again even while cb runs.
+        cb_();
+    }
+
+    Scheduler &scheduler_;
+    std::function<void()> cb_;
+    const std::chrono::microseconds delay_;
+    const std::string name_;
+    // End of the current burst's quiet period in Clock ticks, kIdle if there is no burst.
+    std::atomic<int64_t> deadline_{kIdle};
+};
+
+template <typename Scheduler>
+constexpr int64_t BasicDebouncer<Scheduler>::kIdle;
+
+using Debouncer = BasicDebouncer<TimerScheduler>;
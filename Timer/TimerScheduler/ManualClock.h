@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * A virtual clock that only moves when told to. It satisfies the std::chrono Clock requirements, so it can be
+ * plugged into BasicTimerScheduler in place of std::chrono::steady_clock, e.g.
+ *
+ *   BasicTimerScheduler<ManualClock> fs;
+ *   fs.addFunction([&] { ... }, seconds(1), "ticker");
+ *   fs.start();
+ *   fs.advance(hours(24)); // runs "ticker" 86401 times without sleeping
+ *
+ * Like the std clocks the time is global to the process. Tests that use it should call reset() first.
+ */
+class ManualClock
+{
+public:
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<ManualClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+        return time_point(duration(ticks().load(std::memory_order_acquire)));
+    }
+
+    // Moves the clock forward by d. Negative durations are ignored, the clock never goes back.
+    template <typename Rep, typename Period>
+    static void advance(std::chrono::duration<Rep, Period> d) noexcept
+    {
+        const rep delta = std::chrono::duration_cast<duration>(d).count();
+        if (delta > 0)
+        {
+            ticks().fetch_add(delta, std::memory_order_acq_rel);
+        }
+    }
+
+    // Moves the clock back to its epoch.
+    static void reset() noexcept
+    {
+        ticks().store(0, std::memory_order_release);
+    }
+
+private:
+    static std::atomic<rep> &ticks() noexcept
+    {
+        static std::atomic<rep> ticks{0};
+        return ticks;
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include "TimerScheduler.h"
+
+/**
+ * Calls cb at most maxCalls times per interval. E.g.,
+ *
+ *   TimerScheduler fs;
+ *   Throttler flush(fs, [&] { flushStats(); }, 10, seconds(1), "flushStats");
+ *   fs.start();
+ *   ........
+ *   flush.trigger(); // as often as you like
+ *
+ * trigger() calls cb right away in the calling thread while the current interval has calls left. Otherwise the call
+ * is dropped, and one trailing call is made from the scheduler's thread when the interval ends, so the last trigger()
+ * is never lost. An interval starts with the first trigger() after the previous one ended.
+ *
+ * The throttler owns one idle function in the scheduler (see addIdleFunction()), armed once per interval. With a
+ * locking scheduler (e.g. TimerScheduler) trigger() may be called from any thread; it is a single atomic increment
+ * unless it starts a new interval. With a thread-less scheduler (LoopTimerScheduler, NullMutex) it must be called
+ * from the thread that calls runExpired().
+ */
+template <typename Scheduler>
+class BasicThrottler
+{
+public:
+    BasicThrottler(Scheduler &scheduler, std::function<void()> cb, uint64_t maxCalls, std::chrono::microseconds interval, std::string nameID)
+        : scheduler_(scheduler), cb_(std::move(cb)), maxCalls_(maxCalls), interval_(interval), name_(std::move(nameID))
+    {
+        if (maxCalls_ == 0)
+        {
+            throw std::invalid_argument("Throttler: at least one call per interval must be allowed");
+        }
+        if (interval_ <= std::chrono::microseconds::zero())
+        {
+            throw std::invalid_argument("Throttler: interval must be positive");
+        }
+        scheduler_.addIdleFunction([this]
+                                   { onIntervalEnd(); }, name_);
+    }
+
+    ~BasicThrottler()
+    {
+        scheduler_.cancelFunctionAndWait(name_);
+    }
+
+    BasicThrottler(const BasicThrottler &) = delete;
+    BasicThrottler &operator=(const BasicThrottler &) = delete;
+
+    // Returns true if cb was called, false if the call was throttled.
+    bool trigger()
+    {
+        const uint64_t calls = calls_.fetch_add(1, std::memory_order_acq_rel);
+        if (calls == 0)
+        {
+            // First call of a new interval.
+            scheduler_.armFunction(name_, interval_);
+        }
+        if (calls < maxCalls_)
+        {
+            cb_();
+            return true;
+        }
+        return false;
+    }
+
+private:
+    void onIntervalEnd()
+    {
+        if (calls_.exchange(0, std::memory_order_acq_rel) > maxCalls_)
+        {
+            // Calls were dropped during the interval, make the trailing one. It counts towards the next interval.
+            trigger();
+        }
+    }
+
+    Scheduler &scheduler_;
+    std::function<void()> cb_;
+    const uint64_t maxCalls_;
+    const std::chrono::microseconds interval_;
+    const std::string name_;
+    // trigger() calls in the current interval, including the dropped ones. 0 when no interval is running.
+    std::atomic<uint64_t> calls_{0};
+};
+
+using Throttler = BasicThrottler<TimerScheduler>;
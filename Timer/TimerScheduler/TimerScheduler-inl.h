@@ -0,0 +1,801 @@
+// Implementation of BasicTimerScheduler, included at the bottom of TimerScheduler.h.
+#pragma once
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <future>
+#include <system_error>
+
+struct ConstIntervalFunctor
+{
+    const std::chrono::microseconds constInterval;
+    explicit ConstIntervalFunctor(std::chrono::microseconds interval) : constInterval(interval)
+    {
+        if (interval < std::chrono::microseconds::zero())
+        {
+            throw std::invalid_argument("TimerScheduler: time interval must be non-negative");
+        }
+    }
+    std::chrono::microseconds operator()() const { return constInterval; }
+};
+
+template <typename Clock, typename Mutex>
+BasicTimerScheduler<Clock, Mutex>::BasicTimerScheduler() = default;
+
+template <typename Clock, typename Mutex>
+BasicTimerScheduler<Clock, Mutex>::~BasicTimerScheduler()
+{
+    shutdown();
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::start()
+{
+    std::unique_lock<Mutex> lock(mutex_);
+    if (running_)
+    {
+        return false;
+    }
+
+    if (logging_)
+    {
+        std::cout << "Starting TimerScheduler with " << functions_.size() << " functions." << std::endl;
+    }
+    auto now = Clock::now();
+    // Reset the next run time. for all functions. this is needed since one can shutdown() and start() again
+    for (auto &entry : functions_)
+    {
+        RepeatFunc &f = slots_[entry.index];
+        f.resetNextRunTime(now);
+        entry.deadline = f.getNextRunTime();
+        if (logging_)
+        {
+            std::cout << "   - func: " << (f.name.empty() ? "(anon)" : f.name.c_str())
+                      << ", period = " << f.intervalDescr
+                      << ", delay = " << f.startDelay.count() << "ms" << std::endl;
+        }
+    }
+    std::make_heap(functions_.begin(), functions_.end(), fnCmp_);
+
+    // Without an internal thread the owner drives the functions through runExpired().
+    if (kThreaded)
+    {
+        // The thread applies the thread options to itself, and reports back before it starts running functions.
+        std::promise<std::error_code> applied;
+        std::future<std::error_code> appliedResult = applied.get_future();
+        thread_ = std::thread([this, applied = std::move(applied)]() mutable
+                              {
+            const std::error_code ec = applyThreadOptions(threadOptions_);
+            applied.set_value(ec);
+            if (!ec)
+            {
+                this->run();
+            } });
+        const std::error_code ec = appliedResult.get();
+        if (ec)
+        {
+            thread_.join();
+            throw std::system_error(ec, "TimerScheduler: failed to apply thread options");
+        }
+    }
+    running_ = true;
+
+    return true;
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::shutdown()
+{
+    {
+        std::lock_guard<Mutex> lock(mutex_);
+        if (!running_)
+        {
+            return false;
+        }
+
+        running_ = false;
+        runningCondvar_.notify_all();
+    }
+    if (kThreaded)
+    {
+        thread_.join();
+    }
+    else
+    {
+        // Mirror the end of run(): hand pending functions back so start() can rebuild the heap.
+        functions_.insert(functions_.end(), readyFunctions_.begin(), readyFunctions_.end());
+        readyFunctions_.clear();
+        overloaded_ = false;
+    }
+    return true;
+}
+
+template <typename Clock, typename Mutex>
+TimerSchedulerStats BasicTimerScheduler<Clock, Mutex>::getStats()
+{
+    std::lock_guard<Mutex> lock(mutex_);
+    return stats_;
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::isIdle(TimePoint now) const
+{
+    return readyFunctions_.empty() && currentFunction_ == nullptr &&
+           (functions_.empty() || functions_.front().deadline > now);
+}
+
+template <typename Clock, typename Mutex>
+typename BasicTimerScheduler<Clock, Mutex>::TimePoint BasicTimerScheduler<Clock, Mutex>::nextDeadline()
+{
+    std::lock_guard<Mutex> lock(mutex_);
+    if (!running_)
+    {
+        // Run times are only assigned by start().
+        return TimePoint::max();
+    }
+    // Drop cancelled functions from the top, so they don't cause needless wakeups.
+    while (!functions_.empty() && !slots_[functions_.front().index].isValid())
+    {
+        std::pop_heap(functions_.begin(), functions_.end(), fnCmp_);
+        freeSlot(functions_.back().index);
+        functions_.pop_back();
+    }
+
+    TimePoint deadline = TimePoint::max();
+    for (const auto &entry : readyFunctions_)
+    {
+        deadline = std::min(deadline, entry.deadline);
+    }
+    if (!functions_.empty())
+    {
+        deadline = std::min(deadline, functions_.front().deadline);
+    }
+    return deadline;
+}
+
+template <typename Clock, typename Mutex>
+size_t BasicTimerScheduler<Clock, Mutex>::runExpired(TimePoint now)
+{
+    static_assert(!kThreaded, "runExpired() is only available without an internal thread, use NullMutex");
+    std::unique_lock<Mutex> lock(mutex_);
+    return runExpiredLocked(lock, now);
+}
+
+template <typename Clock, typename Mutex>
+size_t BasicTimerScheduler<Clock, Mutex>::runExpiredLocked(std::unique_lock<Mutex> &lock, TimePoint now)
+{
+    if (!running_)
+    {
+        return 0;
+    }
+
+    // Only the functions expired as of now are run, so a function that reschedules itself with a zero interval
+    // can't keep the caller's event loop busy forever.
+    collectExpiredFunctions(now);
+    size_t count = 0;
+    while (running_ && !readyFunctions_.empty())
+    {
+        count += runOneFunction(lock, now);
+        // Leave the overloaded state as soon as the backlog is drained below the threshold, not only on the next call.
+        updateOverloaded();
+    }
+    return count;
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::runUntilIdle()
+{
+    std::unique_lock<Mutex> lock(mutex_);
+    if (!kThreaded)
+    {
+        while (running_ && !isIdle(Clock::now()))
+        {
+            runExpiredLocked(lock, Clock::now());
+        }
+        return;
+    }
+    runningCondvar_.notify_all();
+    runningCondvar_.wait(lock, [this]()
+                         { return !running_ || isIdle(Clock::now()); });
+}
+
+template <typename Clock, typename Mutex>
+template <typename Rep, typename Period>
+void BasicTimerScheduler<Clock, Mutex>::advance(std::chrono::duration<Rep, Period> d)
+{
+    const TimePoint target = Clock::now() + std::chrono::duration_cast<typename Clock::duration>(d);
+    {
+        std::unique_lock<Mutex> lock(mutex_);
+        while (running_)
+        {
+            if (kThreaded)
+            {
+                runningCondvar_.wait(lock, [this]()
+                                     { return !running_ || isIdle(Clock::now()); });
+            }
+            else
+            {
+                while (running_ && !isIdle(Clock::now()))
+                {
+                    runExpiredLocked(lock, Clock::now());
+                }
+            }
+            if (!running_ || functions_.empty() || functions_.front().deadline > target)
+            {
+                break;
+            }
+            // Step to the next deadline and let the functions due there run before moving on.
+            Clock::advance(functions_.front().deadline - Clock::now());
+            runningCondvar_.notify_all();
+        }
+        Clock::advance(target - Clock::now());
+        runningCondvar_.notify_all();
+    }
+    runUntilIdle();
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::addFunction(std::function<void()> &&cb, std::chrono::microseconds interval, std::string nameID, std::chrono::microseconds startDelay, TimerPriority priority)
+{
+    if (kVirtualClock && interval == std::chrono::microseconds::zero())
+    {
+        throw std::invalid_argument("TimerScheduler: time interval must be positive on a virtual clock");
+    }
+    // A function joining a bucket first runs on the bucket's tick, which would not honour a start delay.
+    if (intervalGrouping_ && startDelay == std::chrono::microseconds::zero())
+    {
+        addFunctionToBucketChecked(std::move(cb), interval, nameID, priority);
+        return;
+    }
+    addFunctionToHeapChecked(std::move(cb), ConstIntervalFunctor(interval), nameID, std::to_string(interval.count()) + "us", startDelay, false /*runOnce*/, priority);
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::addFunctionOnce(std::function<void()> &&cb, std::string nameID, std::chrono::microseconds startDelay, TimerPriority priority)
+{
+    addFunctionToHeapChecked(std::move(cb), ConstIntervalFunctor(std::chrono::microseconds::zero()), nameID, "once", startDelay, true /*runOnce*/, priority);
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::addIdleFunction(std::function<void()> &&cb, std::string nameID, TimerPriority priority)
+{
+    addFunctionToHeapChecked(std::move(cb), ConstIntervalFunctor(std::chrono::microseconds::zero()), nameID, "idle", std::chrono::microseconds::zero(), false /*runOnce*/, priority, true /*idle*/);
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::armFunction(const std::string &nameID, std::chrono::microseconds delay)
+{
+    if (delay < std::chrono::microseconds::zero())
+    {
+        throw std::invalid_argument("TimerScheduler: arm delay must be non-negative");
+    }
+
+    std::unique_lock<Mutex> lock(mutex_);
+    if (currentFunction_ && currentFunction_->name == nameID)
+    {
+        // The function is arming itself. runOneFunction() will put it back into the heap instead of parking it.
+        if (!currentFunction_->rearmable || currentFunction_->armed)
+        {
+            return false;
+        }
+        currentFunction_->armed = true;
+        currentFunction_->startDelay = delay;
+        currentFunction_->resetNextRunTime(Clock::now());
+        return true;
+    }
+
+    auto it = functionsMap_.find(nameID);
+    if (it == functionsMap_.end() || !slots_[it->second].isValid())
+    {
+        return false;
+    }
+    RepeatFunc &func = slots_[it->second];
+    if (!isIdleFunction(func))
+    {
+        // Not rearmable, or armed already and waiting in the heap.
+        return false;
+    }
+
+    // Put the existing slot into the heap. startDelay makes start() honour the delay if we are not running yet.
+    func.armed = true;
+    func.startDelay = delay;
+    func.resetNextRunTime(Clock::now());
+    scheduleFunction(it->second);
+    if (running_)
+    {
+        runningCondvar_.notify_all();
+    }
+    return true;
+}
+
+template <typename Clock, typename Mutex>
+uint32_t BasicTimerScheduler<Clock, Mutex>::allocateSlot(RepeatFunc &&func)
+{
+    if (!freeSlots_.empty())
+    {
+        const uint32_t index = freeSlots_.back();
+        freeSlots_.pop_back();
+        slots_[index] = std::move(func);
+        return index;
+    }
+    if (slots_.size() >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("TimerScheduler: too many functions");
+    }
+    slots_.push_back(std::move(func));
+    return static_cast<uint32_t>(slots_.size() - 1);
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::freeSlot(uint32_t index)
+{
+    // Release the callbacks and strings now, the slot itself is kept for reuse.
+    slots_[index] = RepeatFunc();
+    freeSlots_.push_back(index);
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::scheduleFunction(uint32_t index)
+{
+    const RepeatFunc &func = slots_[index];
+    functions_.push_back(HeapEntry{func.getNextRunTime(), index, func.priority});
+    // We only maintain the heap property while running_ is set, start() builds the heap.
+    if (running_)
+    {
+        std::push_heap(functions_.begin(), functions_.end(), fnCmp_);
+    }
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::checkFunction(const std::function<void()> &cb, std::chrono::microseconds startDelay)
+{
+    if (!cb)
+    {
+        throw std::invalid_argument("TimerScheduler: Scheduled function must be set");
+    }
+    if (startDelay < std::chrono::microseconds::zero())
+    {
+        throw std::invalid_argument("TimerScheduler: start delay must be non-negative");
+    }
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::checkNameAvailable(const std::string &nameID)
+{
+    auto it = functionsMap_.find(nameID);
+    if (it != functionsMap_.end() && slots_[it->second].isValid())
+    {
+        throw std::invalid_argument("TimerScheduler: a function named \"" + nameID + "\" already exists");
+    }
+    if (currentFunction_ && currentFunction_->name == nameID)
+    {
+        throw std::invalid_argument("TimerScheduler: a function named \"" + nameID + "\" already exists");
+    }
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::addFunctionToBucketChecked(std::function<void()> &&cb, std::chrono::microseconds interval, const std::string &nameID,
+                                                                   TimerPriority priority)
+{
+    const std::chrono::microseconds startDelay = std::chrono::microseconds::zero();
+    checkFunction(cb, startDelay);
+    ConstIntervalFunctor intervalFn(interval);
+    const std::string intervalDescr = std::to_string(interval.count()) + "us";
+
+    std::unique_lock<Mutex> lock(mutex_);
+    checkNameAvailable(nameID);
+
+    const uint32_t member = allocateSlot(RepeatFunc(std::move(cb), intervalFn, nameID, intervalDescr, startDelay, false /*runOnce*/, priority));
+    functionsMap_[nameID] = member;
+
+    // Join the open bucket only if its next tick is due, so the function still runs right away. Before start() every
+    // bucket is due, start() resets them all to now.
+    const BucketKey key(interval.count(), priority);
+    auto it = buckets_.find(key);
+    if (it != buckets_.end() && (!running_ || slots_[it->second].getNextRunTime() <= Clock::now()))
+    {
+        slots_[it->second].members.push_back(member);
+        return;
+    }
+
+    // Otherwise open a new bucket with its own phase, later functions join that one. The old bucket keeps running its
+    // members, it just doesn't take new ones.
+    // The bucket itself is a nameless heap entry; its cb is never called, it only marks the entry as valid.
+    const uint32_t bucket = allocateSlot(RepeatFunc([] {}, intervalFn, std::string(), intervalDescr, startDelay, false /*runOnce*/, priority));
+    slots_[bucket].members.push_back(member);
+    buckets_[key] = bucket;
+    if (running_)
+    {
+        slots_[bucket].resetNextRunTime(Clock::now());
+    }
+    scheduleFunction(bucket);
+    if (running_)
+    {
+        runningCondvar_.notify_all();
+    }
+}
+
+template <typename Clock, typename Mutex>
+template <typename IntervalFunc>
+void BasicTimerScheduler<Clock, Mutex>::addFunctionToHeapChecked(std::function<void()> &&cb, IntervalFunc &&fn, const std::string &nameID, const std::string &intervalDescr, std::chrono::microseconds startDelay, bool runOnce,
+                                              TimerPriority priority, bool idle)
+{
+    checkFunction(cb, startDelay);
+
+    std::unique_lock<Mutex> lock(mutex_);
+    checkNameAvailable(nameID);
+
+    const uint32_t index = allocateSlot(RepeatFunc(std::move(cb), std::forward<IntervalFunc>(fn), nameID, intervalDescr, startDelay, runOnce, priority));
+    functionsMap_[nameID] = index;
+
+    assert(lock.mutex() == &mutex_);
+    assert(lock.owns_lock());
+
+    if (idle)
+    {
+        // Idle functions stay out of the heap until armFunction() is called.
+        slots_[index].rearmable = true;
+        return;
+    }
+
+    if (running_)
+    {
+        slots_[index].resetNextRunTime(Clock::now());
+    }
+    scheduleFunction(index);
+    if (running_)
+    {
+
+        // Signal the running thread to wake up and see if it needs to change its current scheduling decision.
+        // (notify_all, since runUntilIdle() and cancelFunctionAndWait() callers wait on the same condvar.)
+        runningCondvar_.notify_all();
+    }
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::cancelFunction(std::string nameID)
+{
+    std::unique_lock<Mutex> lock(mutex_);
+    if (currentFunction_ && currentFunction_->name == nameID)
+    {
+        functionsMap_.erase(currentFunction_->name);
+        // This function is currently being run. Clear currentFunction_
+        // The running thread will see this and won't reschedule the function.
+        currentFunction_ = nullptr;
+        cancellingCurrentFunction_ = true;
+        return true;
+    }
+    auto it = functionsMap_.find(nameID);
+    if (it != functionsMap_.end() && slots_[it->second].isValid())
+    {
+        const uint32_t index = it->second;
+        functionsMap_.erase(it);
+        // An idle function is not in the heap, so nobody would drop it lazily. Free it right away.
+        if (isIdleFunction(slots_[index]))
+        {
+            freeSlot(index);
+        }
+        else
+        {
+            slots_[index].cancel();
+        }
+        return true;
+    }
+
+    return false;
+}
+
+template <typename Clock, typename Mutex>
+bool BasicTimerScheduler<Clock, Mutex>::cancelFunctionAndWait(std::string nameID)
+{
+    std::unique_lock<Mutex> lock(mutex_);
+    if (currentFunction_ && currentFunction_->name == nameID)
+    {
+        functionsMap_.erase(currentFunction_->name);
+        // This function is currently being run. Clear currentFunction_
+        // The running thread will see this and won't reschedule the function.
+        currentFunction_ = nullptr;
+        cancellingCurrentFunction_ = true;
+        runningCondvar_.wait(lock, [this]()
+                             { return !cancellingCurrentFunction_; });
+        return true;
+    }
+
+    auto it = functionsMap_.find(nameID);
+    if (it != functionsMap_.end() && slots_[it->second].isValid())
+    {
+        const uint32_t index = it->second;
+        functionsMap_.erase(it);
+        // An idle function is not in the heap, so nobody would drop it lazily. Free it right away.
+        if (isIdleFunction(slots_[index]))
+        {
+            freeSlot(index);
+        }
+        else
+        {
+            slots_[index].cancel();
+        }
+        return true;
+    }
+
+    return false;
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::run()
+{
+    std::unique_lock<Mutex> lock(mutex_);
+    // Allocate and touch the timer storage from this thread, so first-touch places it on the NUMA node we are
+    // pinned to: the heap, the ready list and the slots. Functions added later reuse the preallocated slots.
+    const size_t reserve = threadOptions_.numaLocalReserve;
+    if (functions_.capacity() < reserve)
+    {
+        const size_t size = functions_.size();
+        functions_.resize(reserve);
+        functions_.resize(size);
+    }
+    if (readyFunctions_.capacity() < reserve)
+    {
+        const size_t size = readyFunctions_.size();
+        readyFunctions_.resize(reserve);
+        readyFunctions_.resize(size);
+    }
+    if (slots_.size() < reserve)
+    {
+        const size_t size = slots_.size();
+        slots_.resize(reserve);
+        // allocateSlot() takes from the back, hand out the lowest index first.
+        for (size_t index = reserve; index-- > size;)
+        {
+            freeSlots_.push_back(static_cast<uint32_t>(index));
+        }
+    }
+    while (running_)
+    {
+        const auto now = Clock::now();
+        collectExpiredFunctions(now);
+
+        if (!readyFunctions_.empty())
+        {
+            runOneFunction(lock, now);
+            runningCondvar_.notify_all();
+        }
+        else if (functions_.empty())
+        {
+            // Let runUntilIdle() callers know there is nothing left to do.
+            runningCondvar_.notify_all();
+            runningCondvar_.wait(lock);
+        }
+        else
+        {
+            // Wait until we actually need to run the earliest function.
+            runningCondvar_.notify_all();
+            runningCondvar_.wait_for(lock, functions_.front().deadline - now);
+        }
+    }
+
+    // Hand functions that were due but not run yet back to functions_, start() rebuilds the heap from there.
+    functions_.insert(functions_.end(), readyFunctions_.begin(), readyFunctions_.end());
+    readyFunctions_.clear();
+    overloaded_ = false;
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::collectExpiredFunctions(TimePoint now)
+{
+    while (!functions_.empty() && (functions_.front().deadline <= now || !slots_[functions_.front().index].isValid()))
+    {
+        std::pop_heap(functions_.begin(), functions_.end(), fnCmp_);
+        const HeapEntry entry = functions_.back();
+        functions_.pop_back();
+        if (slots_[entry.index].isValid())
+        {
+            readyFunctions_.push_back(entry);
+            std::push_heap(readyFunctions_.begin(), readyFunctions_.end(), ReadyOrder{overloaded_});
+        }
+        else
+        {
+            freeSlot(entry.index);
+        }
+    }
+    updateOverloaded();
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::updateOverloaded()
+{
+    // The ordering only changes when we enter or leave the overloaded state, rebuild the heap then.
+    const bool overloaded = readyFunctions_.size() > overloadThreshold_;
+    if (overloaded && !overloaded_)
+    {
+        ++stats_.overloadedBatches;
+    }
+    if (overloaded != overloaded_)
+    {
+        std::make_heap(readyFunctions_.begin(), readyFunctions_.end(), ReadyOrder{overloaded});
+    }
+    overloaded_ = overloaded;
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::updateNextRunTime(RepeatFunc &func, TimePoint now)
+{
+    if (steady_)
+    {
+        // This allows scheduler to catch up
+        func.setNextRunTimeSteady();
+    }
+    else
+    {
+        // Note that we set nextRunTime based on the current time where we started
+        // the function call, rather than the time when the function finishes.
+        // This ensures that we call the function once every time interval, as
+        // opposed to waiting time interval seconds between calls.  (These can be
+        // different if the function takes a significant amount of time to run.)
+        func.setNextRunTimeStrict(now);
+    }
+}
+
+template <typename Clock, typename Mutex>
+void BasicTimerScheduler<Clock, Mutex>::invokeFunction(RepeatFunc &func)
+{
+    try
+    {
+        if (logging_)
+        {
+            std::cout << "Now running " << func.name << std::endl;
+        }
+        func.cb();
+    }
+    catch (const std::exception &ex)
+    {
+        std::cout << "Error running the scheduled function <" << func.name << ">: " << ex.what() << std::endl;
+    }
+}
+
+template <typename Clock, typename Mutex>
+size_t BasicTimerScheduler<Clock, Mutex>::runBucket(std::unique_lock<Mutex> &lock, uint32_t bucketIndex, TimePoint now)
+{
+    assert(lock.mutex() == &mutex_);
+    assert(lock.owns_lock());
+
+    // The whole bucket is rescheduled once, its members share the run time.
+    RepeatFunc &bucket = slots_[bucketIndex];
+    updateNextRunTime(bucket, now);
+
+    // Functions joining the bucket while it runs wait for the next tick.
+    const size_t count = bucket.members.size();
+    size_t invoked = 0;
+    for (size_t i = 0; i < count && running_; ++i)
+    {
+        // members may grow while mutex_ is unlocked, so don't hold on to a reference into it.
+        RepeatFunc &member = slots_[bucket.members[i]];
+        if (!member.isValid())
+        {
+            continue;
+        }
+        currentFunction_ = &member;
+        lock.unlock();
+        invokeFunction(member);
+        lock.lock();
+        ++invoked;
+        if (!currentFunction_)
+        {
+            // The member was cancelled while we were running it.
+            member.cancel();
+            cancellingCurrentFunction_ = false;
+            runningCondvar_.notify_all();
+        }
+        currentFunction_ = nullptr;
+    }
+
+    // Drop cancelled members, keeping the FIFO order of the others.
+    auto &members = bucket.members;
+    for (uint32_t member : members)
+    {
+        if (!slots_[member].isValid())
+        {
+            freeSlot(member);
+        }
+    }
+    members.erase(std::remove_if(members.begin(), members.end(), [this](uint32_t member)
+                                 { return !slots_[member].isValid(); }),
+                  members.end());
+    if (members.empty())
+    {
+        // Only the open bucket of an interval is in buckets_.
+        for (auto it = buckets_.begin(); it != buckets_.end(); ++it)
+        {
+            if (it->second == bucketIndex)
+            {
+                buckets_.erase(it);
+                break;
+            }
+        }
+        freeSlot(bucketIndex);
+        return invoked;
+    }
+
+    scheduleFunction(bucketIndex);
+    return invoked;
+}
+
+template <typename Clock, typename Mutex>
+size_t BasicTimerScheduler<Clock, Mutex>::runOneFunction(std::unique_lock<Mutex> &lock, TimePoint now)
+{
+    assert(lock.mutex() == &mutex_);
+    assert(lock.owns_lock());
+
+    // The function to run is at the front of the readyFunctions_ heap.
+    // Fully remove it from readyFunctions_ now.
+    // We need to release mutex_ while we invoke this function, and the other functions must stay reachable while mutex_ is unlocked.
+    std::pop_heap(readyFunctions_.begin(), readyFunctions_.end(), ReadyOrder{overloaded_});
+    const uint32_t index = readyFunctions_.back().index;
+    readyFunctions_.pop_back();
+    RepeatFunc &func = slots_[index];
+    if (!func.cb)
+    {
+        if (logging_)
+        {
+            std::cout << func.name << "function has been canceled while waiting" << std::endl;
+        }
+        freeSlot(index);
+        return 0;
+    }
+    if (overloaded_ && func.priority != TimerPriority::High)
+    {
+        // A bucket stands for all of its members.
+        const uint64_t runs = func.members.empty() ? 1 : func.members.size();
+        if (func.priority == TimerPriority::Low && !func.runOnce && !func.rearmable)
+        {
+            // Shed this run of a periodic low-priority function, it will get another chance next interval.
+            stats_.shedCount += runs;
+            updateNextRunTime(func, now);
+            scheduleFunction(index);
+            return 0;
+        }
+        stats_.delayedCount += runs;
+    }
+    if (!func.members.empty())
+    {
+        return runBucket(lock, index, now);
+    }
+    currentFunction_ = &func;
+    updateNextRunTime(func, now);
+    // A rearmable function only runs again if it gets armed again.
+    func.armed = false;
+
+    lock.unlock();
+    invokeFunction(func);
+    lock.lock();
+
+    if (!currentFunction_)
+    {
+        // The function was cancelled while we were running it. We shouldn't reschedule it;
+        cancellingCurrentFunction_ = false;
+        freeSlot(index);
+        return 1;
+    }
+    // Clear currentFunction_
+    currentFunction_ = nullptr;
+
+    if (func.runOnce)
+    {
+        // Don't reschedule if the function only needed to run once.
+        functionsMap_.erase(func.name);
+        freeSlot(index);
+        return 1;
+    }
+    if (isIdleFunction(func))
+    {
+        // Park it in its slot until the next armFunction().
+        return 1;
+    }
+
+    // Re-insert the function into our functions_ heap.
+    // We only maintain the heap property while running_ is set.  (running_ may have been cleared while we were invoking the user's function.)
+    scheduleFunction(index);
+    return 1;
+}
@@ -5,9 +5,18 @@
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <deque>
+#include <map>
+#include <tuple>
 #include <vector>
 #include <string>
 #include <functional>
+#include <limits>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "ManualClock.h"
+#include "../ThreadOptions.h"
 
 /**
  * Schedules any number of functions to run at various intervals. E.g.,
@@ -31,41 +40,82 @@
  *
  * start() schedules the functions, while shutdown() terminates further
  * scheduling.
+ *
+ * The clock is a template parameter. TimerScheduler uses std::chrono::steady_clock, while
+ * BasicTimerScheduler<ManualClock> runs on virtual time which only moves in advance(), so days of
+ * schedules can be simulated in a fraction of a second.
+ */
+
+/**
+ * Priority class of a scheduled function.
+ * Priorities are only consulted while the scheduler is overloaded, i.e. when more functions are due than the
+ * dispatch thread can keep up with (see setOverloadThreshold()). Otherwise functions simply run in deadline order.
  */
+enum class TimerPriority
+{
+    High = 0,
+    Normal = 1,
+    Low = 2,
+};
+
+// Counters describing how the scheduler behaved while overloaded.
+struct TimerSchedulerStats
+{
+    uint64_t overloadedBatches{0}; // Number of times the expired backlog grew beyond the overload threshold.
+    uint64_t shedCount{0};         // Runs of periodic low-priority functions that were skipped while overloaded.
+    // Runs of normal/low-priority functions made while overloaded, i.e. while they were ordered behind every
+    // higher-priority function in the backlog. Not all of them actually had a higher-priority function ahead.
+    uint64_t delayedCount{0};
+};
 
 // A type alias for function that is called to determine the time interval for the next scheduled run.
 using IntervalDistributionFunc = std::function<std::chrono::microseconds()>;
 
 // A type alias for function that returns the next run time, given the current start time.
-using NextRunTimeFunc = std::function<std::chrono::steady_clock::time_point(std::chrono::steady_clock::time_point)>;
+template <typename Clock>
+using BasicNextRunTimeFunc = std::function<typename Clock::time_point(typename Clock::time_point)>;
+using NextRunTimeFunc = BasicNextRunTimeFunc<std::chrono::steady_clock>;
 
-struct RepeatFunc
+template <typename Clock>
+struct BasicRepeatFunc
 {
+    using TimePoint = typename Clock::time_point;
+
     std::function<void()> cb;
-    NextRunTimeFunc nextRunTimeFunc;
-    std::chrono::steady_clock::time_point nextRunTime;
+    BasicNextRunTimeFunc<Clock> nextRunTimeFunc;
+    TimePoint nextRunTime;
     std::string name;
-    std::chrono::microseconds startDelay;
+    std::chrono::microseconds startDelay{0};
     std::string intervalDescr;
-    bool runOnce;
+    bool runOnce{false};
+    TimerPriority priority{TimerPriority::Normal};
+    bool rearmable{false}; // Added by addIdleFunction(): goes idle after each run instead of being rescheduled.
+    bool armed{false};     // armFunction() was called for a rearmable function since its last run.
+    // Only set for an interval bucket (see setIntervalGrouping()): slots of the grouped functions, run in FIFO order.
+    std::vector<uint32_t> members;
+
+    // An empty (free) slot.
+    BasicRepeatFunc() = default;
 
-    RepeatFunc(std::function<void()> &&cback, IntervalDistributionFunc &&intervalFn, const std::string &nameID,
-               const std::string &intervalDistDescription, std::chrono::microseconds delay, bool once) : cb(std::move(cback)),
-                                                                                                         nextRunTimeFunc(getNextRunTimeFunc(std::move(intervalFn))),
-                                                                                                         name(nameID),
-                                                                                                         intervalDescr(intervalDistDescription),
-                                                                                                         startDelay(delay),
-                                                                                                         runOnce(once) {}
+    BasicRepeatFunc(std::function<void()> &&cback, IntervalDistributionFunc &&intervalFn, const std::string &nameID,
+               const std::string &intervalDistDescription, std::chrono::microseconds delay, bool once,
+               TimerPriority prio = TimerPriority::Normal) : cb(std::move(cback)),
+                                                             nextRunTimeFunc(getNextRunTimeFunc(std::move(intervalFn))),
+                                                             name(nameID),
+                                                             intervalDescr(intervalDistDescription),
+                                                             startDelay(delay),
+                                                             runOnce(once),
+                                                             priority(prio) {}
 
-    static NextRunTimeFunc getNextRunTimeFunc(IntervalDistributionFunc &&intervalFn)
+    static BasicNextRunTimeFunc<Clock> getNextRunTimeFunc(IntervalDistributionFunc &&intervalFn)
     {
-        return [intervalFn = std::move(intervalFn)](std::chrono::steady_clock::time_point curTime) mutable
+        return [intervalFn = std::move(intervalFn)](TimePoint curTime) mutable
         {
             return curTime + intervalFn();
         };
     }
 
-    std::chrono::steady_clock::time_point getNextRunTime() const
+    TimePoint getNextRunTime() const
     {
         return nextRunTime;
     }
@@ -73,11 +123,11 @@ struct RepeatFunc
     {
         nextRunTime = nextRunTimeFunc(nextRunTime);
     }
-    void setNextRunTimeStrict(std::chrono::steady_clock::time_point curTime)
+    void setNextRunTimeStrict(TimePoint curTime)
     {
         nextRunTime = nextRunTimeFunc(curTime);
     }
-    void resetNextRunTime(std::chrono::steady_clock::time_point curTime)
+    void resetNextRunTime(TimePoint curTime)
     {
         nextRunTime = curTime + startDelay;
     }
@@ -92,15 +142,101 @@ struct RepeatFunc
     }
 };
 
-class TimerScheduler
+using RepeatFunc = BasicRepeatFunc<std::chrono::steady_clock>;
+
+/**
+ * Entry of the scheduler's heap. The heap only holds these small entries; the callback, name, description and the
+ * rest of a function stay in its BasicRepeatFunc, in a separate slot array. Every sift step of push_heap/pop_heap
+ * thus compares entries packed four to a cache line, instead of chasing a pointer into a large, cold RepeatFunc.
+ */
+template <typename Clock>
+struct BasicTimerHeapEntry
+{
+    typename Clock::time_point deadline; // The function's nextRunTime when the entry was pushed.
+    uint32_t index;                      // Slot of the function.
+    TimerPriority priority;              // The function's priority, for ordering expired functions.
+};
+
+/**
+ * Locking policy that does nothing. A BasicTimerScheduler using it starts no internal thread and takes no locks,
+ * it is meant to be owned and driven by a single thread, e.g. an event loop:
+ *
+ *   LoopTimerScheduler fs;
+ *   fs.addFunction([&] { ... }, seconds(1), "ticker");
+ *   fs.start();
+ *   while (loop.alive())
+ *   {
+ *       loop.poll(fs.nextDeadline());
+ *       fs.runExpired(std::chrono::steady_clock::now());
+ *   }
+ */
+struct NullMutex
+{
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+};
+
+// Condition variable stand-in for NullMutex: there is nobody to wait for, so waits return immediately.
+struct NullCondvar
+{
+    void notify_one() {}
+    void notify_all() {}
+    template <typename Lock>
+    void wait(Lock &) {}
+    template <typename Lock, typename Predicate>
+    void wait(Lock &, Predicate) {}
+    template <typename Lock, typename Rep, typename Period>
+    void wait_for(Lock &, const std::chrono::duration<Rep, Period> &) {}
+};
+
+template <typename Mutex>
+struct TimerSchedulerCondvar
+{
+    using type = std::condition_variable_any;
+};
+template <>
+struct TimerSchedulerCondvar<std::mutex>
+{
+    using type = std::condition_variable;
+};
+template <>
+struct TimerSchedulerCondvar<NullMutex>
+{
+    using type = NullCondvar;
+};
+
+// Whether Clock is a virtual clock, i.e. time only moves when Clock::advance() is called (like ManualClock).
+template <typename Clock, typename = void>
+struct IsVirtualClock : std::false_type
+{
+};
+template <typename Clock>
+struct IsVirtualClock<Clock, decltype(Clock::advance(std::chrono::nanoseconds(0)))> : std::true_type
+{
+};
+
+template <typename Clock = std::chrono::steady_clock, typename Mutex = std::mutex>
+class BasicTimerScheduler
 {
 public:
-    TimerScheduler();
-    ~TimerScheduler();
+    using ClockType = Clock;
+    using TimePoint = typename Clock::time_point;
+    using RepeatFunc = BasicRepeatFunc<Clock>;
+
+    // Whether start() spawns a thread to run the functions. With NullMutex the owner calls runExpired() instead.
+    static constexpr bool kThreaded = !std::is_same<Mutex, NullMutex>::value;
+    // Whether time only moves in advance(), see IsVirtualClock.
+    static constexpr bool kVirtualClock = IsVirtualClock<Clock>::value;
+
+    BasicTimerScheduler();
+    ~BasicTimerScheduler();
 
     /**
      * Starts the scheduler.
      * Returns false if the scheduler was already running.
+     * Throws std::system_error if the thread options can't be applied to the new thread, the scheduler is not
+     * started in that case.
      */
     bool start();
 
@@ -122,16 +258,110 @@ public:
      */
     void setSteady(bool steady) { steady_ = steady; }
 
+    /**
+     * Sets the number of expired functions the dispatch thread may fall behind before it considers itself overloaded.
+     * While overloaded, expired functions run by priority class first and earliest deadline second (EDF within a class),
+     * periodic TimerPriority::Low functions are shed (their current run is skipped and they are rescheduled for the next
+     * interval) and one-shot TimerPriority::Low functions are deferred behind everything else.
+     * By default the threshold is unlimited, i.e. functions always run in deadline order.
+     *
+     * NOTE: it's only safe to set this before calling start()
+     */
+    void setOverloadThreshold(size_t threshold) { overloadThreshold_ = threshold; }
+
+    /**
+     * Sets the CPU affinity, scheduling class, nice level and name of the thread created by start(), and optionally
+     * preallocates the heap, the ready list and numaLocalReserve timer slots on that thread's NUMA node. Functions
+     * added later reuse those slots; functions added before start() keep theirs, and whatever a callback or name
+     * allocates on the heap still comes from the thread that adds the function. See ThreadOptions.
+     * Not used without an internal thread; the owner of the loop can call applyThreadOptions() on its own thread.
+     *
+     * NOTE: it's only safe to set this before calling start()
+     */
+    void setThreadOptions(const ThreadOptions &options) { threadOptions_ = options; }
+
+    /**
+     * By default every function added by addFunction() is its own heap entry. With grouping enabled, functions with
+     * the same interval and priority and no start delay share one heap entry (an interval bucket) holding them in a
+     * FIFO list: one wakeup runs the whole list and reschedules it with a single heap operation, so the heap only
+     * grows with the number of distinct intervals. After start() a function only joins a bucket whose next tick is
+     * due, otherwise it opens a new bucket ticking from now, so it runs right away as it would ungrouped.
+     * Functions with a start delay (which a bucket's tick could not honour), and functions added by addFunctionOnce()
+     * and addIdleFunction(), are never grouped.
+     *
+     * NOTE: it's only safe to set this before adding functions
+     */
+    void setIntervalGrouping(bool grouping) { intervalGrouping_ = grouping; }
+
+    // Returns a snapshot of the overload counters.
+    TimerSchedulerStats getStats();
+
+    /**
+     * Enables or disables the per-run log lines ("Now running ..."). Logging is on by default; turn it off when
+     * running large simulations.
+     */
+    void setLogging(bool logging) { logging_ = logging; }
+
+    /**
+     * Blocks until the running thread has run every function that is due at the current time.
+     * Without an internal thread the functions are run in the calling thread instead.
+     * Returns immediately if the scheduler is not running.
+     * Mainly useful with a virtual clock: after moving the clock it guarantees that all expired functions have run.
+     */
+    void runUntilIdle();
+
+    /**
+     * Moves a virtual clock (e.g. ManualClock) forward by d, stopping at every intermediate deadline so that each
+     * function runs at its own virtual time, exactly as many times as it would have on a real clock.
+     * Returns once everything due at the new time has run. Only available for clocks that provide advance().
+     */
+    template <typename Rep, typename Period>
+    void advance(std::chrono::duration<Rep, Period> d);
+
+    /**
+     * Returns the earliest time at which a function is due, or TimePoint::max() if there is none or the scheduler
+     * is not running.
+     * An event loop can use it as its poll timeout.
+     */
+    TimePoint nextDeadline();
+
+    /**
+     * Runs every function that is due at now in the calling thread and returns how many ran; every member of an
+     * interval bucket counts (see setIntervalGrouping()).
+     * Only available without an internal thread (Mutex = NullMutex); start() must have been called.
+     */
+    size_t runExpired(TimePoint now);
+
     /**
      * Adds a new function to the TimerScheduler.
      * Functions will not be run until start() is called.  When start() is called, each function will be run after its specified startDelay.
-     * Functions may also be added after start() has been called, in which case startDelay is still honored.
+     * Functions may also be added after start() has been called, in which case startDelay is still honored (this holds
+     * with setIntervalGrouping() too).
      * Throws an exception on error.  In particular, each function must have a unique name--two functions cannot be added with the same name.
+     * On a virtual clock the interval must be positive: a function due again at the same virtual time would keep
+     * advance() and runUntilIdle() from ever returning.
      */
-    void addFunction(std::function<void()> &&cb, std::chrono::microseconds interval, std::string nameID, std::chrono::microseconds startDelay = std::chrono::microseconds(0));
+    void addFunction(std::function<void()> &&cb, std::chrono::microseconds interval, std::string nameID, std::chrono::microseconds startDelay = std::chrono::microseconds(0),
+                     TimerPriority priority = TimerPriority::Normal);
 
     // Adds a new function to the TimerScheduler to run only once.
-    void addFunctionOnce(std::function<void()> &&cb, std::string nameID, std::chrono::microseconds startDelay = std::chrono::microseconds(0));
+    void addFunctionOnce(std::function<void()> &&cb, std::string nameID, std::chrono::microseconds startDelay = std::chrono::microseconds(0),
+                         TimerPriority priority = TimerPriority::Normal);
+
+    /**
+     * Adds a function that is not scheduled until armFunction() is called. Each armFunction() makes it run once,
+     * after which it goes idle but stays registered under nameID, so it can be armed again without allocating a new
+     * entry or a new name. cancelFunction() removes it. This is the building block of Debouncer and Throttler.
+     * Throws an exception on error, like addFunction().
+     */
+    void addIdleFunction(std::function<void()> &&cb, std::string nameID, TimerPriority priority = TimerPriority::Normal);
+
+    /**
+     * Schedules a function added by addIdleFunction() to run once after delay.
+     * Returns false if no such function exists or it is already armed. It may be called from the function itself,
+     * which then runs again after delay.
+     */
+    bool armFunction(const std::string &nameID, std::chrono::microseconds delay);
 
     /**
      * Cancels the function with the specified name, so it will no longer be run.
@@ -141,38 +371,102 @@ public:
     bool cancelFunctionAndWait(std::string nameID);
 
 private:
+    using HeapEntry = BasicTimerHeapEntry<Clock>;
+
     struct RunTimeOrder
     {
-        bool operator()(const std::unique_ptr<RepeatFunc> &f1, const std::unique_ptr<RepeatFunc> &f2) const
+        bool operator()(const HeapEntry &e1, const HeapEntry &e2) const
         {
-            return f1->getNextRunTime() > f2->getNextRunTime();
+            return e1.deadline > e2.deadline;
         }
     };
 
-    typedef std::vector<std::unique_ptr<RepeatFunc>> FunctionHeap;
-    typedef std::unordered_map<std::string, RepeatFunc *> FunctionMap;
+    // Orders the expired functions so that the one to run next is at the back.
+    struct ReadyOrder
+    {
+        bool byPriority;
+        bool operator()(const HeapEntry &e1, const HeapEntry &e2) const
+        {
+            if (byPriority && e1.priority != e2.priority)
+            {
+                return e1.priority > e2.priority;
+            }
+            return e1.deadline > e2.deadline;
+        }
+    };
+
+    typedef std::vector<HeapEntry> FunctionHeap;
+    typedef std::vector<HeapEntry> FunctionList;
+    typedef std::deque<RepeatFunc> FunctionSlots;
+    typedef std::unordered_map<std::string, uint32_t> FunctionMap;
+    // Interval (us) and priority of an interval bucket. Maps to the bucket new functions join (see setIntervalGrouping()).
+    typedef std::tuple<int64_t, TimerPriority> BucketKey;
+    typedef std::map<BucketKey, uint32_t> BucketMap;
 
     void run();
-    void runOneFunction(std::unique_lock<std::mutex> &lock, std::chrono::steady_clock::time_point now);
+    void collectExpiredFunctions(TimePoint now);
+    // Enters or leaves the overloaded state depending on the size of the backlog.
+    void updateOverloaded();
+    // Both return how many functions they invoked.
+    size_t runOneFunction(std::unique_lock<Mutex> &lock, TimePoint now);
+    size_t runBucket(std::unique_lock<Mutex> &lock, uint32_t bucketIndex, TimePoint now);
+    void invokeFunction(RepeatFunc &func);
+    size_t runExpiredLocked(std::unique_lock<Mutex> &lock, TimePoint now);
+    void updateNextRunTime(RepeatFunc &func, TimePoint now);
+    bool isIdle(TimePoint now) const;
 
     template <typename IntervalFunc>
     void addFunctionToHeapChecked(std::function<void()> &&cb, IntervalFunc &&fn, const std::string &nameID,
-                                  const std::string &intervalDescr, std::chrono::microseconds startDelay, bool runOnce);
+                                  const std::string &intervalDescr, std::chrono::microseconds startDelay, bool runOnce,
+                                  TimerPriority priority, bool idle = false);
+    void addFunctionToBucketChecked(std::function<void()> &&cb, std::chrono::microseconds interval, const std::string &nameID,
+                                    TimerPriority priority);
+    void checkFunction(const std::function<void()> &cb, std::chrono::microseconds startDelay);
+    void checkNameAvailable(const std::string &nameID);
+    uint32_t allocateSlot(RepeatFunc &&func);
+    void freeSlot(uint32_t index);
+    void scheduleFunction(uint32_t index);
+    bool isIdleFunction(const RepeatFunc &func) const { return func.rearmable && !func.armed; }
 
     std::thread thread_;
-    std::mutex mutex_;
+    Mutex mutex_;
     bool running_{false};
 
     FunctionHeap functions_; // This is a heap, ordered by next run time.
     FunctionMap functionsMap_;
     RunTimeOrder fnCmp_;
 
+    // The functions themselves, indexed by HeapEntry::index. Freed slots are reused through freeSlots_. A deque, so
+    // references to a function stay valid while the running thread invokes it with mutex_ unlocked.
+    // Functions added by addIdleFunction() that are currently not armed, and bucket members, are in slots_ and
+    // functionsMap_, but not in the heap.
+    FunctionSlots slots_;
+    std::vector<uint32_t> freeSlots_;
+
+    // Interval buckets by key. The buckets themselves are heap entries like any other function.
+    BucketMap buckets_;
+    bool intervalGrouping_{false};
+
+    // Functions whose run time has passed, taken off the heap and waiting for the running thread.
+    // A heap ordered by ReadyOrder, so the next function to run is at the front.
+    FunctionList readyFunctions_;
+    size_t overloadThreshold_{std::numeric_limits<size_t>::max()};
+    bool overloaded_{false};
+    TimerSchedulerStats stats_;
+
     // The function currently being invoked by the running thread.This is null when the running thread is idle
     RepeatFunc *currentFunction_{nullptr};
 
     // Condition variable that is signalled whenever a new function is added or when the TimerScheduler is stopped.
-    std::condition_variable runningCondvar_;
+    typename TimerSchedulerCondvar<Mutex>::type runningCondvar_;
 
     bool steady_{false};
+    bool logging_{true};
+    ThreadOptions threadOptions_;
     bool cancellingCurrentFunction_{false};
-};
\ No newline at end of file
+};
+
+using TimerScheduler = BasicTimerScheduler<>;
+using LoopTimerScheduler = BasicTimerScheduler<std::chrono::steady_clock, NullMutex>;
+
+#include "TimerScheduler-inl.h"
\ No newline at end of file
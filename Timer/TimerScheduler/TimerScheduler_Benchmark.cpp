@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "TimerScheduler.h"
+#include "../TimerCnt/TimerBench.h"
+#include "../TimerCnt/PerfCounter.h"
+
+using namespace std::chrono;
+
+/**************************************
+TimerScheduler的基准测试,不是单元测试,需要手动运行(最好用Release编译):
+
+    ./TimerScheduler_Benchmark [定时器个数,默认1000000]
+
+1. scheduler: 在ManualClock上的LoopTimerScheduler里放入n个周期和首次延迟都随机(1ms到1h)的定时器,
+   每次操作把虚拟时钟推进到nextDeadline再runExpired,走的是调度器真实的路径:收集到期函数、就绪队列、
+   按槽位号找到函数、执行、重新放回堆里。报告每次分发的耗时和缓存未命中次数
+2. heap layout: 单独比较堆操作本身,旧布局的堆里是unique_ptr<RepeatFunc>,每次比较都要解引用到冷节点;
+   新布局的堆里是{deadline, index},冷数据放在槽位数组里。每次操作是"弹出最早到期的定时器,再按周期放回去"
+硬件计数器打不开时(容器、虚拟机、perf_event_paranoid)只报告耗时。
+***********************************************/
+
+namespace
+{
+    const size_t kCountedOps = 100000;
+
+    BenchOptions benchOptions()
+    {
+        BenchOptions options;
+        options.repetitions = 20;
+        options.targetTime = milliseconds(5);
+        return options;
+    }
+
+    void printMisses(const PerfCounter &counter, const char *name, uint64_t misses, uint64_t ops)
+    {
+        if (counter.available())
+            std::printf("%-24s cache misses per op: %.2f\n", name, double(misses) / double(ops));
+        else
+            std::printf("%-24s cache misses per op: hardware counters are not available\n", name);
+    }
+
+    void benchScheduler(size_t timers)
+    {
+        ManualClock::reset();
+        BasicTimerScheduler<ManualClock, NullMutex> scheduler;
+        scheduler.setLogging(false);
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<int64_t> randomUs(1000, 3600LL * 1000000);
+        uint64_t runs = 0;
+        for (size_t i = 0; i < timers; ++i)
+        {
+            scheduler.addFunction([&runs]
+                                  { ++runs; }, microseconds(randomUs(rng)), "timer" + std::to_string(i), microseconds(randomUs(rng)));
+        }
+        scheduler.start();
+
+        auto dispatch = [&]
+        {
+            const auto deadline = scheduler.nextDeadline();
+            ManualClock::advance(deadline - ManualClock::now());
+            return scheduler.runExpired(deadline);
+        };
+
+        TimerBench bench(benchOptions());
+        BenchResult result = bench.run("scheduler dispatch", dispatch);
+        TimerBench::print(result);
+
+        PerfCounter misses;
+        const uint64_t before = runs;
+        misses.start();
+        for (size_t i = 0; i < kCountedOps; ++i)
+            doNotOptimize(dispatch());
+        const uint64_t count = misses.stop();
+        printMisses(misses, "scheduler dispatch", count, runs - before);
+        scheduler.shutdown();
+    }
+
+    void benchHeapLayout(size_t timers)
+    {
+        using HeapEntry = BasicTimerHeapEntry<steady_clock>;
+
+        // 两种布局用同样的初始到期时间和周期序列
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<int64_t> randomUs(1000, 3600LL * 1000000);
+        std::vector<microseconds> deadlines(timers), intervals(4096);
+        for (auto &d : deadlines)
+            d = microseconds(randomUs(rng));
+        for (auto &d : intervals)
+            d = microseconds(randomUs(rng));
+        const auto base = steady_clock::now();
+
+        auto makeFunc = [&](size_t i)
+        {
+            RepeatFunc func([] {}, []
+                            { return seconds(1); }, "timer" + std::to_string(i), "1000000us", microseconds(0), false);
+            func.nextRunTime = base + deadlines[i];
+            return func;
+        };
+
+        TimerBench bench(benchOptions());
+        PerfCounter misses;
+        BenchResult pointerResult, entryResult;
+
+        // 两种布局依次测试,同一时间只占一份内存
+        {
+            std::vector<std::unique_ptr<RepeatFunc>> heap;
+            heap.reserve(timers);
+            for (size_t i = 0; i < timers; ++i)
+                heap.push_back(std::make_unique<RepeatFunc>(makeFunc(i)));
+            auto cmp = [](const std::unique_ptr<RepeatFunc> &f1, const std::unique_ptr<RepeatFunc> &f2)
+            { return f1->getNextRunTime() > f2->getNextRunTime(); };
+            std::make_heap(heap.begin(), heap.end(), cmp);
+
+            size_t k = 0;
+            auto op = [&]
+            {
+                std::pop_heap(heap.begin(), heap.end(), cmp);
+                RepeatFunc &func = *heap.back();
+                func.nextRunTime += intervals[k++ % intervals.size()];
+                std::push_heap(heap.begin(), heap.end(), cmp);
+                return func.nextRunTime;
+            };
+            pointerResult = bench.run("unique_ptr heap", op);
+            misses.start();
+            for (size_t i = 0; i < kCountedOps; ++i)
+                doNotOptimize(op());
+            printMisses(misses, "unique_ptr heap", misses.stop(), kCountedOps);
+        }
+
+        {
+            std::deque<RepeatFunc> slots;
+            std::vector<HeapEntry> heap;
+            heap.reserve(timers);
+            for (size_t i = 0; i < timers; ++i)
+            {
+                slots.push_back(makeFunc(i));
+                heap.push_back(HeapEntry{slots.back().nextRunTime, uint32_t(i), TimerPriority::Normal});
+            }
+            auto cmp = [](const HeapEntry &e1, const HeapEntry &e2)
+            { return e1.deadline > e2.deadline; };
+            std::make_heap(heap.begin(), heap.end(), cmp);
+
+            size_t k = 0;
+            auto op = [&]
+            {
+                std::pop_heap(heap.begin(), heap.end(), cmp);
+                HeapEntry &entry = heap.back();
+                RepeatFunc &func = slots[entry.index];
+                func.nextRunTime += intervals[k++ % intervals.size()];
+                entry.deadline = func.nextRunTime;
+                std::push_heap(heap.begin(), heap.end(), cmp);
+                return func.nextRunTime;
+            };
+            entryResult = bench.run("{deadline, index} heap", op);
+            misses.start();
+            for (size_t i = 0; i < kCountedOps; ++i)
+                doNotOptimize(op());
+            printMisses(misses, "{deadline, index} heap", misses.stop(), kCountedOps);
+        }
+
+        TimerBench::print(pointerResult);
+        TimerBench::print(entryResult);
+        TimerBench::print(bench.compare(pointerResult, entryResult));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t timers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::printf("%zu timers\n", timers);
+    benchScheduler(timers);
+    benchHeapLayout(timers);
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include <chrono>
 #include <thread>
 #include "TimerScheduler.h"
+#include "Debouncer.h"
+#include "Throttler.h"
 
 using namespace std::chrono;
 
@@ -30,73 +32,85 @@ private:
 // 测试添加和运行单个函数
 TEST(TimerSchedulerTest, SingleFunction)
 {
-    TimerScheduler scheduler;
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
     Counter counter;
 
     scheduler.addFunction([&]
                           { counter.increment(); }, milliseconds(100), "increment");
 
     scheduler.start();
-    std::this_thread::sleep_for(milliseconds(350)); // 等待足够时间让函数运行几次
+    scheduler.advance(milliseconds(350)); // 在0、100、200、300ms各运行一次
     scheduler.shutdown();
-    printf("call_count = %d\n", counter.count());
+    EXPECT_EQ(counter.count(), 4);
 }
 // 测试一次性函数
 TEST(TimerSchedulerTest, SingleRunFunction)
 {
-    TimerScheduler scheduler;
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
     Counter counter;
 
     scheduler.addFunctionOnce([&]
                               { counter.increment(); }, "incrementOnce", milliseconds(100));
 
     scheduler.start();
-    std::this_thread::sleep_for(milliseconds(200)); // 等待足够时间让函数运行一次
+    scheduler.advance(milliseconds(99)); // 还没到startDelay
+    EXPECT_EQ(counter.count(), 0);
+    scheduler.advance(milliseconds(101)); // 只运行一次
     scheduler.shutdown();
-
-    printf("call_count = %d\n", counter.count());
+    EXPECT_EQ(counter.count(), 1);
 }
 
 // 测试取消函数
 TEST(TimerSchedulerTest, CancelFunction)
 {
-    TimerScheduler scheduler;
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
     Counter counter;
 
     scheduler.addFunction([&]
                           { counter.increment(); }, milliseconds(100), "increment");
 
     scheduler.start();
-    std::this_thread::sleep_for(milliseconds(150)); // 运行一次
-    scheduler.cancelFunction("increment");
-    std::this_thread::sleep_for(milliseconds(200)); // 等待，确保函数不再运行
+    scheduler.advance(milliseconds(150)); // 在0、100ms各运行一次
+    EXPECT_EQ(counter.count(), 2);
+    EXPECT_TRUE(scheduler.cancelFunction("increment"));
+    EXPECT_FALSE(scheduler.cancelFunction("increment"));
+    scheduler.advance(milliseconds(200)); // 确保函数不再运行
     scheduler.shutdown();
-
-    printf("call_count = %d\n", counter.count());
+    EXPECT_EQ(counter.count(), 2);
 }
 
 // 测试取消并等待函数
 TEST(TimerSchedulerTest, CancelFunctionAndWait)
 {
-    TimerScheduler scheduler;
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
     Counter counter;
 
     scheduler.addFunction([&]
                           { counter.increment(); }, milliseconds(100), "increment");
 
     scheduler.start();
-    std::this_thread::sleep_for(milliseconds(150)); // 运行一次
-    scheduler.cancelFunctionAndWait("increment");
-    std::this_thread::sleep_for(milliseconds(200)); // 等待，确保函数不再运行
+    scheduler.advance(milliseconds(150)); // 在0、100ms各运行一次
+    EXPECT_EQ(counter.count(), 2);
+    EXPECT_TRUE(scheduler.cancelFunctionAndWait("increment"));
+    scheduler.advance(milliseconds(200)); // 确保函数不再运行
     scheduler.shutdown();
-
-    printf("call_count = %d\n", counter.count());
+    EXPECT_EQ(counter.count(), 2);
 }
 
 // 测试多个函数在堆里执行
 TEST(TimerSchedulerTest, MultipleFunctions)
 {
-    TimerScheduler scheduler;
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
     Counter counter1, counter2, counter3;
 
     scheduler.addFunction([&]
@@ -107,16 +121,431 @@ TEST(TimerSchedulerTest, MultipleFunctions)
                           { counter3.increment(); }, milliseconds(150), "increment3", milliseconds(150));
 
     scheduler.start();
-    std::this_thread::sleep_for(milliseconds(500)); // 等待足够时间让函数运行几次
+    scheduler.advance(milliseconds(500));
+    // increment1: 50..450ms; increment2: 100、300、500ms; increment3: 150、300、450ms
+    EXPECT_EQ(counter1.count(), 5);
+    EXPECT_EQ(counter2.count(), 3);
+    EXPECT_EQ(counter3.count(), 3);
+
+    // start之后添加的函数同样遵守startDelay：在650、850ms运行
     scheduler.addFunction([&]
                           { counter3.increment(); }, milliseconds(200), "increment4", milliseconds(150));
-    std::this_thread::sleep_for(milliseconds(500)); // 等待足够时间让函数运行几次
+    scheduler.advance(milliseconds(500));
+    scheduler.shutdown();
+    EXPECT_EQ(counter1.count(), 10);
+    EXPECT_EQ(counter2.count(), 5);
+    EXPECT_EQ(counter3.count(), 3 + 3 + 2);
+}
+
+// 虚拟时钟上周期为0的函数会让advance()永远停在同一时刻，添加时就拒绝
+TEST(TimerSchedulerTest, ZeroIntervalOnVirtualClock)
+{
+    BasicTimerScheduler<ManualClock> scheduler;
+    EXPECT_THROW(scheduler.addFunction([] {}, microseconds(0), "zero"), std::invalid_argument);
+    EXPECT_NO_THROW(scheduler.addFunctionOnce([] {}, "once"));
+
+    TimerScheduler realScheduler;
+    EXPECT_NO_THROW(realScheduler.addFunction([] {}, microseconds(0), "zero"));
+}
+
+// 测试过载时按优先级调度，低优先级的周期函数被丢弃
+TEST(TimerSchedulerTest, OverloadPriority)
+{
+    TimerScheduler scheduler;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](const std::string &name)
+    {
+        return [&, name]
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+        };
+    };
+
+    scheduler.setOverloadThreshold(2);
+    scheduler.addFunction(record("low"), seconds(1), "low1", microseconds(0), TimerPriority::Low);
+    scheduler.addFunction(record("low"), seconds(1), "low2", microseconds(0), TimerPriority::Low);
+    scheduler.addFunction(record("low"), seconds(1), "low3", microseconds(0), TimerPriority::Low);
+    scheduler.addFunctionOnce(record("normal1"), "normal1", microseconds(0), TimerPriority::Normal);
+    scheduler.addFunctionOnce(record("normal2"), "normal2", microseconds(0), TimerPriority::Normal);
+    scheduler.addFunctionOnce(record("high"), "high", microseconds(0), TimerPriority::High);
+
+    scheduler.start();
+    std::this_thread::sleep_for(milliseconds(100));
+    scheduler.shutdown();
+
+    TimerSchedulerStats stats = scheduler.getStats();
+    // 积压6个函数，阈值为2：high先执行，normal随后，积压回落到阈值前丢弃一个low
+    ASSERT_EQ(order.size(), 5u);
+    EXPECT_EQ(order[0], "high");
+    EXPECT_EQ(order[1].substr(0, 6), "normal");
+    EXPECT_EQ(order[2].substr(0, 6), "normal");
+    EXPECT_EQ(stats.overloadedBatches, 1u);
+    EXPECT_EQ(stats.shedCount, 1u);
+    EXPECT_EQ(stats.delayedCount, 2u);
+}
+
+// 没有内部线程时也一样：积压回落到阈值以下后，本次runExpired()剩下的函数不再被丢弃
+TEST(TimerSchedulerTest, LoopOverloadPriority)
+{
+    LoopTimerScheduler scheduler;
+    scheduler.setLogging(false);
+    std::vector<std::string> order;
+    auto record = [&](const std::string &name)
+    {
+        return [&, name]
+        { order.push_back(name); };
+    };
+
+    scheduler.setOverloadThreshold(2);
+    scheduler.addFunction(record("low"), seconds(1), "low1", microseconds(0), TimerPriority::Low);
+    scheduler.addFunction(record("low"), seconds(1), "low2", microseconds(0), TimerPriority::Low);
+    scheduler.addFunction(record("low"), seconds(1), "low3", microseconds(0), TimerPriority::Low);
+    scheduler.addFunctionOnce(record("normal1"), "normal1", microseconds(0), TimerPriority::Normal);
+    scheduler.addFunctionOnce(record("normal2"), "normal2", microseconds(0), TimerPriority::Normal);
+    scheduler.addFunctionOnce(record("high"), "high", microseconds(0), TimerPriority::High);
 
+    scheduler.start();
+    EXPECT_EQ(scheduler.runExpired(steady_clock::now()), 5u);
     scheduler.shutdown();
-    printf("call_count = %d\n", counter1.count());
-    printf("call_count = %d\n", counter2.count());
-    printf("call_count = %d\n", counter3.count());
+
+    TimerSchedulerStats stats = scheduler.getStats();
+    ASSERT_EQ(order.size(), 5u);
+    EXPECT_EQ(order[0], "high");
+    EXPECT_EQ(order[1].substr(0, 6), "normal");
+    EXPECT_EQ(order[2].substr(0, 6), "normal");
+    EXPECT_EQ(stats.overloadedBatches, 1u);
+    EXPECT_EQ(stats.shedCount, 1u);
+    EXPECT_EQ(stats.delayedCount, 2u);
+}
+
+// 测试虚拟时钟：advance推进虚拟时间，不需要真正sleep
+TEST(TimerSchedulerTest, VirtualClock)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
+    Counter counter, counterOnce;
+
+    scheduler.addFunction([&]
+                          { counter.increment(); }, milliseconds(100), "increment");
+    scheduler.addFunctionOnce([&]
+                              { counterOnce.increment(); }, "incrementOnce", milliseconds(200));
+
+    scheduler.start();
+    scheduler.advance(milliseconds(350)); // 在0、100、200、300ms各运行一次
+    EXPECT_EQ(counter.count(), 4);
+    EXPECT_EQ(counterOnce.count(), 1);
+
+    scheduler.cancelFunction("increment");
+    scheduler.advance(milliseconds(500));
+    scheduler.shutdown();
+    EXPECT_EQ(counter.count(), 4);
+}
+
+// 测试用虚拟时钟快速模拟一个小时的调度
+TEST(TimerSchedulerTest, VirtualClockSimulation)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock> scheduler;
+    scheduler.setLogging(false);
+    Counter counter1, counter2, counter3;
+
+    scheduler.addFunction([&]
+                          { counter1.increment(); }, seconds(1), "increment1");
+    scheduler.addFunction([&]
+                          { counter2.increment(); }, seconds(5), "increment2");
+    scheduler.addFunction([&]
+                          { counter3.increment(); }, seconds(60), "increment3");
+
+    scheduler.start();
+    scheduler.advance(hours(1));
+    scheduler.shutdown();
+
+    EXPECT_EQ(counter1.count(), 3601);
+    EXPECT_EQ(counter2.count(), 721);
+    EXPECT_EQ(counter3.count(), 61);
+}
+
+// 测试没有内部线程、不加锁的调度器，由调用者的事件循环驱动
+TEST(TimerSchedulerTest, LoopScheduler)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock, NullMutex> scheduler;
+    scheduler.setLogging(false);
+    int count = 0, countOnce = 0;
+    std::thread::id runner;
+
+    scheduler.addFunction([&]
+                          { ++count; runner = std::this_thread::get_id(); }, milliseconds(100), "increment");
+    scheduler.addFunctionOnce([&]
+                              { ++countOnce; scheduler.cancelFunction("increment"); }, "cancelOnce", milliseconds(250));
+    EXPECT_EQ(scheduler.nextDeadline(), ManualClock::time_point::max());
+
+    scheduler.start();
+    const auto begin = ManualClock::now();
+    EXPECT_EQ(scheduler.nextDeadline(), begin);
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 1u);
+    EXPECT_EQ(runner, std::this_thread::get_id());
+    EXPECT_EQ(scheduler.nextDeadline(), begin + milliseconds(100));
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 0u);
+
+    ManualClock::advance(milliseconds(100));
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 1u);
+    EXPECT_EQ(scheduler.nextDeadline(), begin + milliseconds(200));
+
+    // 在250ms时一次性函数取消了周期函数
+    scheduler.advance(seconds(1));
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(countOnce, 1);
+    EXPECT_EQ(scheduler.nextDeadline(), ManualClock::time_point::max());
+    scheduler.shutdown();
+}
+
+// 测试防抖：一连串的trigger只在安静delay以后执行一次
+TEST(TimerSchedulerTest, Debouncer)
+{
+    using LoopScheduler = BasicTimerScheduler<ManualClock, NullMutex>;
+    ManualClock::reset();
+    LoopScheduler scheduler;
+    scheduler.setLogging(false);
+    int count = 0;
+    BasicDebouncer<LoopScheduler> debouncer(scheduler, [&]
+                                            { ++count; }, milliseconds(100), "debounce");
+    scheduler.start();
+
+    debouncer.trigger();
+    scheduler.advance(milliseconds(50));
+    debouncer.trigger();
+    scheduler.advance(milliseconds(50));
+    debouncer.trigger();
+    scheduler.advance(milliseconds(99)); // 最后一次trigger在100ms，应该在200ms执行
+    EXPECT_EQ(count, 0);
+    scheduler.advance(milliseconds(1));
+    EXPECT_EQ(count, 1);
+    scheduler.advance(seconds(1));
+    EXPECT_EQ(count, 1);
+
+    debouncer.trigger();
+    scheduler.advance(milliseconds(100));
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(scheduler.nextDeadline(), ManualClock::time_point::max()); // 空闲时不占用堆
+}
+
+// 测试节流：每个周期最多执行maxCalls次，被丢弃的调用在周期结束时补一次
+TEST(TimerSchedulerTest, Throttler)
+{
+    using LoopScheduler = BasicTimerScheduler<ManualClock, NullMutex>;
+    ManualClock::reset();
+    LoopScheduler scheduler;
+    scheduler.setLogging(false);
+    int count = 0;
+    BasicThrottler<LoopScheduler> throttler(scheduler, [&]
+                                            { ++count; }, 2, milliseconds(100), "throttle");
+    scheduler.start();
+
+    EXPECT_TRUE(throttler.trigger());
+    EXPECT_TRUE(throttler.trigger());
+    EXPECT_FALSE(throttler.trigger());
+    EXPECT_FALSE(throttler.trigger());
+    EXPECT_EQ(count, 2);
+
+    scheduler.advance(milliseconds(100)); // 周期结束，补一次调用并开始新周期
+    EXPECT_EQ(count, 3);
+    EXPECT_TRUE(throttler.trigger());
+    EXPECT_FALSE(throttler.trigger());
+    EXPECT_EQ(count, 4);
+
+    scheduler.advance(milliseconds(100));
+    EXPECT_EQ(count, 5);
+    scheduler.advance(milliseconds(100)); // 上个周期只有补的那一次调用，不再补
+    EXPECT_EQ(count, 5);
+    EXPECT_TRUE(throttler.trigger());
+    EXPECT_EQ(count, 6);
+}
+
+// 测试多线程调度器下的防抖
+TEST(TimerSchedulerTest, DebouncerThreaded)
+{
+    TimerScheduler scheduler;
+    scheduler.setLogging(false);
+    Counter counter;
+    Debouncer debouncer(scheduler, [&]
+                        { counter.increment(); }, milliseconds(50), "debounce");
+    scheduler.start();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        debouncer.trigger();
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    std::this_thread::sleep_for(milliseconds(150));
+    EXPECT_EQ(counter.count(), 1);
+}
+
+// 测试相同周期的函数合并到同一个桶里，按加入顺序执行
+TEST(TimerSchedulerTest, IntervalGrouping)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock, NullMutex> scheduler;
+    scheduler.setLogging(false);
+    scheduler.setIntervalGrouping(true);
+    std::vector<int> order;
+    std::vector<int> counts(100, 0);
+    int slowCount = 0;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        scheduler.addFunction([&, i]
+                              { order.push_back(i); ++counts[i]; }, milliseconds(100), "fast" + std::to_string(i));
+    }
+    scheduler.addFunction([&]
+                          { ++slowCount; }, seconds(1), "slow");
+    scheduler.start();
+
+    // 100个100ms的函数只占一个堆节点，一次runExpired里全部执行，返回值按实际执行的函数计数
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 101u);
+    ASSERT_EQ(order.size(), 100u);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(order[i], i);
+    }
+
+    scheduler.cancelFunction("fast0");
+    EXPECT_THROW(scheduler.addFunction([] {}, milliseconds(100), "fast1"), std::invalid_argument);
+    scheduler.addFunction([&]
+                          { ++counts[0]; }, milliseconds(100), "late");
+    scheduler.advance(seconds(1));
+    // late在0ms开了一个新桶，所以在0、100...1000ms执行11次
+    EXPECT_EQ(counts[0], 1 + 11);
+    EXPECT_EQ(counts[1], 11);
+    EXPECT_EQ(counts[99], 11);
+    EXPECT_EQ(slowCount, 2);
+
+    // 桶里的函数都取消以后，桶也会从堆里移除
+    for (int i = 1; i < 100; ++i)
+    {
+        scheduler.cancelFunction("fast" + std::to_string(i));
+    }
+    scheduler.cancelFunction("late");
+    scheduler.cancelFunction("slow");
+    scheduler.advance(seconds(1));
+    EXPECT_EQ(scheduler.nextDeadline(), ManualClock::time_point::max());
+    scheduler.shutdown();
+}
+
+// 测试start以后加入分桶的函数：不会等到已有桶的下一次执行，而是马上执行
+TEST(TimerSchedulerTest, IntervalGroupingPhase)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock, NullMutex> scheduler;
+    scheduler.setLogging(false);
+    scheduler.setIntervalGrouping(true);
+    int early = 0, late1 = 0, late2 = 0;
+
+    scheduler.addFunction([&]
+                          { ++early; }, seconds(10), "early");
+    scheduler.start();
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 1u);
+
+    // 已有的桶下一次在10s执行，1s加入的函数开一个新桶，同一时刻加入的函数共用这个新桶
+    ManualClock::advance(seconds(1));
+    scheduler.addFunction([&]
+                          { ++late1; }, seconds(10), "late1");
+    scheduler.addFunction([&]
+                          { ++late2; }, seconds(10), "late2");
+    EXPECT_EQ(scheduler.runExpired(ManualClock::now()), 2u);
+    EXPECT_EQ(late1, 1);
+    EXPECT_EQ(late2, 1);
+
+    scheduler.advance(seconds(10)); // early在10s，late在11s
+    EXPECT_EQ(early, 2);
+    EXPECT_EQ(late1, 2);
+    EXPECT_EQ(late2, 2);
+    scheduler.shutdown();
+}
+
+// 测试槽位复用:取消和执行完的一次性函数释放槽位和名字,之后可以重新添加
+TEST(TimerSchedulerTest, SlotReuse)
+{
+    ManualClock::reset();
+    BasicTimerScheduler<ManualClock, NullMutex> scheduler;
+    scheduler.setLogging(false);
+    std::vector<int> counts(100, 0);
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            scheduler.addFunctionOnce([&, i]
+                                      { ++counts[i]; }, "once" + std::to_string(i), milliseconds(i));
+        }
+        for (int i = 0; i < 100; i += 2)
+        {
+            EXPECT_TRUE(scheduler.cancelFunction("once" + std::to_string(i)));
+        }
+        scheduler.start();
+        scheduler.advance(milliseconds(100));
+        EXPECT_EQ(scheduler.nextDeadline(), ManualClock::time_point::max());
+        scheduler.shutdown();
+    }
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(counts[i], i % 2 ? 3 : 0);
+    }
+}
+
+#ifdef __linux__
+// 取一个当前线程允许运行的CPU，不能假设CPU 0在cpuset里
+static int allowedCpu()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+                return cpu;
+        }
+    }
+    return 0;
+}
+
+// 测试工作线程的CPU亲和性、线程名，以及设置失败时start抛出异常
+TEST(TimerSchedulerTest, ThreadOptions)
+{
+    TimerScheduler scheduler;
+    ThreadOptions options;
+    const int allowed = allowedCpu();
+    options.cpus = {allowed};
+    options.name = "timer-sched";
+    options.numaLocalReserve = 1024;
+    scheduler.setThreadOptions(options);
+
+    std::mutex mutex;
+    int cpu = -1;
+    char name[16] = {0};
+    scheduler.addFunctionOnce([&]
+                              {
+        std::lock_guard<std::mutex> lock(mutex);
+        cpu = sched_getcpu();
+        pthread_getname_np(pthread_self(), name, sizeof(name)); }, "threadInfo");
+
+    EXPECT_TRUE(scheduler.start());
+    std::this_thread::sleep_for(milliseconds(50));
+    scheduler.shutdown();
+    EXPECT_EQ(cpu, allowed);
+    EXPECT_STREQ(name, "timer-sched");
+
+    options.cpus = {CPU_SETSIZE - 1};
+    scheduler.setThreadOptions(options);
+    EXPECT_THROW(scheduler.start(), std::system_error);
+    EXPECT_FALSE(scheduler.shutdown());
 }
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -0,0 +1,766 @@
+#include "TimerShm.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+    constexpr uint32_t kMagic = 0x54534d31; // "TSM1"
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kHeaderSize = 64;
+    // How long a connected client may take to send its eventfd before the daemon gives up on it.
+    constexpr std::chrono::seconds kRegisterTimeout(1);
+
+    // Reply of the daemon to a registration.
+    struct Hello
+    {
+        int32_t slot;
+        int32_t error; // errno value, 0 on success.
+    };
+
+    std::string segmentName(const std::string &name)
+    {
+        return "/timershm." + name;
+    }
+
+    // The registration socket lives in the abstract namespace, so there is no file to clean up.
+    socklen_t socketAddress(const std::string &name, sockaddr_un &addr)
+    {
+        const std::string path = "timershm." + name;
+        if (path.size() + 1 > sizeof(addr.sun_path))
+        {
+            throw std::invalid_argument("TimerShm: service name is too long");
+        }
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path + 1, path.data(), path.size());
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + path.size());
+    }
+
+    [[noreturn]] void throwErrno(const char *what)
+    {
+        throw std::system_error(errno, std::system_category(), what);
+    }
+
+    // Sends data together with one file descriptor.
+    bool sendWithFd(int sock, const void *data, size_t size, int fd)
+    {
+        iovec iov{const_cast<void *>(data), size};
+        char control[CMSG_SPACE(sizeof(int))];
+        std::memset(control, 0, sizeof(control));
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        return sendmsg(sock, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+    }
+
+    // Receives data and an optional file descriptor (-1 if none was sent).
+    bool recvWithFd(int sock, void *data, size_t size, int &fd)
+    {
+        iovec iov{data, size};
+        char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        fd = -1;
+        if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(size))
+        {
+            return false;
+        }
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+        return true;
+    }
+
+    void signalFd(int fd)
+    {
+        const uint64_t one = 1;
+        // EAGAIN means the counter is saturated, the other side is going to wake up anyway.
+        (void)!write(fd, &one, sizeof(one));
+    }
+
+    void drainFd(int fd)
+    {
+        uint64_t value;
+        (void)!read(fd, &value, sizeof(value));
+    }
+
+    // Every client can write the whole segment, so the daemon checks each request instead of trusting the client.
+    bool validRequest(const TimerShmRequest &request)
+    {
+        if (request.op == TimerShmRequest::Cancel)
+        {
+            return true;
+        }
+        if (request.op != TimerShmRequest::Add && request.op != TimerShmRequest::AddOnce)
+        {
+            return false;
+        }
+        if (request.priority > static_cast<uint32_t>(TimerPriority::Low) || request.startDelayUs < 0)
+        {
+            return false;
+        }
+        // A zero interval would make the timer due all the time and keep the daemon thread spinning.
+        return request.op == TimerShmRequest::AddOnce || request.intervalUs > 0;
+    }
+
+    void closeFd(int &fd)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+TimerShmDaemon::TimerShmDaemon(const std::string &name, uint32_t maxClients) : name_(name), maxClients_(maxClients)
+{
+    if (maxClients_ == 0)
+    {
+        throw std::invalid_argument("TimerShmDaemon: at least one client must be allowed");
+    }
+    segmentSize_ = kHeaderSize + size_t(maxClients_) * sizeof(TimerShmSlot);
+    bool created = false;
+    try
+    {
+        // The abstract socket is the single-instance lock: bind() fails with EADDRINUSE while another daemon
+        // serves this name, and the kernel releases it when that daemon dies. Only the owner touches the segment.
+        listenFd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0)
+        {
+            throwErrno("TimerShmDaemon: socket");
+        }
+        sockaddr_un addr;
+        const socklen_t len = socketAddress(name_, addr);
+        if (bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), len) != 0)
+        {
+            throwErrno("TimerShmDaemon: bind");
+        }
+
+        // A segment left behind by a crashed daemon is replaced.
+        shm_unlink(segmentName(name_).c_str());
+        const int shmFd = shm_open(segmentName(name_).c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (shmFd < 0)
+        {
+            throwErrno("TimerShmDaemon: shm_open");
+        }
+        created = true;
+        if (ftruncate(shmFd, static_cast<off_t>(segmentSize_)) != 0)
+        {
+            const int err = errno;
+            close(shmFd);
+            throw std::system_error(err, std::system_category(), "TimerShmDaemon: ftruncate");
+        }
+        segment_ = mmap(nullptr, segmentSize_, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        close(shmFd);
+        if (segment_ == MAP_FAILED)
+        {
+            segment_ = nullptr;
+            throwErrno("TimerShmDaemon: mmap");
+        }
+        // ftruncate zero-fills the segment, which is a valid initial state for the slots.
+        auto *header = static_cast<TimerShmHeader *>(segment_);
+        header->maxClients = maxClients_;
+        header->slotSize = sizeof(TimerShmSlot);
+        header->version = kVersion;
+        header->magic = kMagic;
+
+        doorbellFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (doorbellFd_ < 0)
+        {
+            throwErrno("TimerShmDaemon: eventfd");
+        }
+
+        // Clients can only connect once the segment is ready.
+        if (listen(listenFd_, 64) != 0)
+        {
+            throwErrno("TimerShmDaemon: listen");
+        }
+    }
+    catch (...)
+    {
+        closeFd(listenFd_);
+        closeFd(doorbellFd_);
+        if (segment_)
+        {
+            munmap(segment_, segmentSize_);
+        }
+        if (created)
+        {
+            shm_unlink(segmentName(name_).c_str());
+        }
+        throw;
+    }
+
+    clients_.resize(maxClients_);
+    scheduler_.setLogging(false);
+    // Clients mostly register the same few housekeeping intervals, share a heap entry per interval.
+    scheduler_.setIntervalGrouping(true);
+    scheduler_.start();
+}
+
+TimerShmDaemon::~TimerShmDaemon()
+{
+    shutdown();
+    for (uint32_t slot = 0; slot < maxClients_; ++slot)
+    {
+        if (clients_[slot].connFd >= 0)
+        {
+            removeClient(slot);
+        }
+    }
+    for (auto &pending : pending_)
+    {
+        close(pending.connFd);
+    }
+    scheduler_.shutdown();
+    closeFd(listenFd_);
+    closeFd(doorbellFd_);
+    munmap(segment_, segmentSize_);
+    shm_unlink(segmentName(name_).c_str());
+}
+
+bool TimerShmDaemon::start()
+{
+    if (running_.exchange(true))
+    {
+        return false;
+    }
+    thread_ = std::thread([this]
+                          { run(); });
+    return true;
+}
+
+bool TimerShmDaemon::shutdown()
+{
+    if (!running_.exchange(false))
+    {
+        return false;
+    }
+    signalFd(doorbellFd_);
+    thread_.join();
+    return true;
+}
+
+size_t TimerShmDaemon::clientCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto &client : clients_)
+    {
+        count += client.connFd >= 0;
+    }
+    return count;
+}
+
+TimerShmSlot &TimerShmDaemon::slotAt(uint32_t slot)
+{
+    return *reinterpret_cast<TimerShmSlot *>(static_cast<char *>(segment_) + kHeaderSize + size_t(slot) * sizeof(TimerShmSlot));
+}
+
+std::string TimerShmDaemon::timerName(uint32_t slot, uint64_t timerId)
+{
+    return std::to_string(slot) + ":" + std::to_string(timerId);
+}
+
+void TimerShmDaemon::run()
+{
+    std::vector<pollfd> fds;
+    std::vector<uint32_t> fdSlots;
+    while (running_)
+    {
+        fds.clear();
+        fdSlots.clear();
+        // Stop accepting while as many handshakes as there are slots are in progress, the kernel queues the rest.
+        fds.push_back({listenFd_, static_cast<short>(pending_.size() < maxClients_ ? POLLIN : 0), 0});
+        fds.push_back({doorbellFd_, POLLIN, 0});
+        for (uint32_t slot = 0; slot < maxClients_; ++slot)
+        {
+            if (clients_[slot].connFd >= 0)
+            {
+                fds.push_back({clients_[slot].connFd, POLLIN, 0});
+                fdSlots.push_back(slot);
+            }
+        }
+        const size_t firstPending = fds.size();
+        for (const auto &pending : pending_)
+        {
+            fds.push_back({pending.connFd, POLLIN, 0});
+        }
+
+        // Sleep until the next timer is due, a client rings the doorbell, a client (dis)connects or sends its eventfd,
+        // or a handshake times out.
+        timespec timeout;
+        timespec *timeoutPtr = nullptr;
+        auto deadline = scheduler_.nextDeadline();
+        for (const auto &pending : pending_)
+        {
+            deadline = std::min(deadline, pending.deadline);
+        }
+        if (deadline != steady_clock::time_point::max())
+        {
+            const auto wait = std::max(deadline - steady_clock::now(), steady_clock::duration::zero());
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+            timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+            timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+            timeoutPtr = &timeout;
+        }
+        if (ppoll(fds.data(), fds.size(), timeoutPtr, nullptr) < 0 && errno != EINTR)
+        {
+            std::cout << "TimerShmDaemon: ppoll failed: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            drainFd(doorbellFd_);
+        }
+        for (size_t i = 2; i < firstPending; ++i)
+        {
+            if (fds[i].revents)
+            {
+                // Clients never send anything after registering, so this is a hangup.
+                removeClient(fdSlots[i - 2]);
+            }
+        }
+        // Slots freed above can be handed out right away.
+        const auto now = steady_clock::now();
+        size_t kept = 0;
+        for (size_t i = 0; i < pending_.size(); ++i)
+        {
+            const bool done = fds[firstPending + i].revents ? registerClient(pending_[i].connFd) : pending_[i].deadline <= now;
+            if (!done)
+            {
+                pending_[kept++] = pending_[i];
+            }
+            else if (!fds[firstPending + i].revents)
+            {
+                std::cout << "TimerShmDaemon: client did not register in time" << std::endl;
+                close(pending_[i].connFd);
+            }
+        }
+        pending_.resize(kept);
+        if (fds[0].revents & POLLIN)
+        {
+            acceptClient();
+        }
+
+        for (uint32_t slot = 0; slot < maxClients_; ++slot)
+        {
+            if (clients_[slot].connFd >= 0)
+            {
+                drainRequests(slot);
+            }
+        }
+
+        scheduler_.runExpired(steady_clock::now());
+
+        // One wakeup per client, however many of its timers expired.
+        for (auto &client : clients_)
+        {
+            if (client.notify)
+            {
+                client.notify = false;
+                signalFd(client.notifyFd);
+            }
+        }
+    }
+}
+
+void TimerShmDaemon::acceptClient()
+{
+    // The socket is non-blocking, so a client that connects and then stalls can't hold up the timers; the handshake
+    // is finished by registerClient() once the client's eventfd arrives.
+    const int conn = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn < 0)
+    {
+        return;
+    }
+    // The abstract socket has no file permissions, anyone may connect. Only serve processes of our own user, like the
+    // 0600 segment does.
+    ucred cred{};
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid())
+    {
+        std::cout << "TimerShmDaemon: rejecting client of uid " << cred.uid << std::endl;
+        close(conn);
+        return;
+    }
+    pending_.push_back(PendingClient{conn, steady_clock::now() + kRegisterTimeout});
+}
+
+bool TimerShmDaemon::registerClient(int conn)
+{
+    char byte;
+    int notifyFd = -1;
+    errno = 0;
+    if (!recvWithFd(conn, &byte, sizeof(byte), notifyFd))
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return false;
+        }
+        close(conn);
+        return true;
+    }
+    if (notifyFd < 0)
+    {
+        close(conn);
+        return true;
+    }
+
+    Hello hello{-1, ENOSPC};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (uint32_t slot = 0; slot < maxClients_; ++slot)
+        {
+            if (clients_[slot].connFd < 0)
+            {
+                TimerShmSlot &shm = slotAt(slot);
+                shm.requests.reset();
+                shm.expiries.reset();
+                shm.droppedExpiries.store(0, std::memory_order_relaxed);
+                shm.active.store(1, std::memory_order_release);
+                clients_[slot].connFd = conn;
+                clients_[slot].notifyFd = notifyFd;
+                hello = Hello{static_cast<int32_t>(slot), 0};
+                break;
+            }
+        }
+    }
+    // The reply is the first thing sent on a fresh connection, so it fits into the socket buffer without blocking.
+    if (!sendWithFd(conn, &hello, sizeof(hello), doorbellFd_) || hello.error != 0)
+    {
+        if (hello.error == 0)
+        {
+            removeClient(static_cast<uint32_t>(hello.slot));
+            return true;
+        }
+        close(notifyFd);
+        close(conn);
+    }
+    return true;
+}
+
+void TimerShmDaemon::removeClient(uint32_t slot)
+{
+    Client &client = clients_[slot];
+    for (uint64_t timerId : client.timers)
+    {
+        scheduler_.cancelFunction(timerName(slot, timerId));
+    }
+    client.timers.clear();
+    client.notify = false;
+    slotAt(slot).active.store(0, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeFd(client.notifyFd);
+    closeFd(client.connFd);
+}
+
+void TimerShmDaemon::drainRequests(uint32_t slot)
+{
+    Client &client = clients_[slot];
+    TimerShmRequest request;
+    while (slotAt(slot).requests.pop(request))
+    {
+        const uint64_t timerId = request.timerId;
+        const std::string name = timerName(slot, timerId);
+        if (!validRequest(request))
+        {
+            std::cout << "TimerShmDaemon: dropping invalid request for timer " << name << std::endl;
+            continue;
+        }
+        try
+        {
+            switch (request.op)
+            {
+            case TimerShmRequest::Add:
+                if (client.timers.insert(timerId).second)
+                {
+                    scheduler_.addFunction([this, slot, timerId]
+                                           { pushExpiry(slot, timerId); }, microseconds(request.intervalUs), name,
+                                           microseconds(request.startDelayUs), static_cast<TimerPriority>(request.priority));
+                }
+                break;
+            case TimerShmRequest::AddOnce:
+                if (client.timers.insert(timerId).second)
+                {
+                    scheduler_.addFunctionOnce([this, slot, timerId]
+                                               {
+                        pushExpiry(slot, timerId);
+                        clients_[slot].timers.erase(timerId); }, name, microseconds(request.startDelayUs),
+                                               static_cast<TimerPriority>(request.priority));
+                }
+                break;
+            case TimerShmRequest::Cancel:
+                if (client.timers.erase(timerId))
+                {
+                    scheduler_.cancelFunction(name);
+                }
+                break;
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            // There is no way back to the client for errors; the client validates its requests before sending.
+            client.timers.erase(timerId);
+            std::cout << "TimerShmDaemon: bad request for timer " << name << ": " << ex.what() << std::endl;
+        }
+    }
+}
+
+void TimerShmDaemon::pushExpiry(uint32_t slot, uint64_t timerId)
+{
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    TimerShmSlot &shm = slotAt(slot);
+    if (!shm.expiries.push(TimerShmExpiry{timerId, now}))
+    {
+        shm.droppedExpiries.fetch_add(1, std::memory_order_relaxed);
+    }
+    clients_[slot].notify = true;
+}
+
+TimerShmClient::TimerShmClient(const std::string &name)
+{
+    try
+    {
+        notifyFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (notifyFd_ < 0)
+        {
+            throwErrno("TimerShmClient: eventfd");
+        }
+
+        connFd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (connFd_ < 0)
+        {
+            throwErrno("TimerShmClient: socket");
+        }
+        sockaddr_un addr;
+        const socklen_t len = socketAddress(name, addr);
+        if (connect(connFd_, reinterpret_cast<sockaddr *>(&addr), len) != 0)
+        {
+            throwErrno("TimerShmClient: connect");
+        }
+
+        const char byte = 0;
+        if (!sendWithFd(connFd_, &byte, sizeof(byte), notifyFd_))
+        {
+            throwErrno("TimerShmClient: register");
+        }
+        Hello hello;
+        if (!recvWithFd(connFd_, &hello, sizeof(hello), doorbellFd_))
+        {
+            throwErrno("TimerShmClient: register");
+        }
+        if (hello.error != 0 || doorbellFd_ < 0)
+        {
+            throw std::system_error(hello.error ? hello.error : EPROTO, std::system_category(), "TimerShmClient: register");
+        }
+
+        const int shmFd = shm_open(segmentName(name).c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (shmFd < 0)
+        {
+            throwErrno("TimerShmClient: shm_open");
+        }
+        struct stat st;
+        if (fstat(shmFd, &st) != 0)
+        {
+            const int err = errno;
+            close(shmFd);
+            throw std::system_error(err, std::system_category(), "TimerShmClient: fstat");
+        }
+        segmentSize_ = static_cast<size_t>(st.st_size);
+        segment_ = mmap(nullptr, segmentSize_, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        close(shmFd);
+        if (segment_ == MAP_FAILED)
+        {
+            segment_ = nullptr;
+            throwErrno("TimerShmClient: mmap");
+        }
+
+        const auto *header = static_cast<const TimerShmHeader *>(segment_);
+        if (header->magic != kMagic || header->version != kVersion || header->slotSize != sizeof(TimerShmSlot) ||
+            hello.slot < 0 || static_cast<uint32_t>(hello.slot) >= header->maxClients)
+        {
+            throw std::system_error(EPROTO, std::system_category(), "TimerShmClient: incompatible segment");
+        }
+        slot_ = reinterpret_cast<TimerShmSlot *>(static_cast<char *>(segment_) + kHeaderSize + size_t(hello.slot) * sizeof(TimerShmSlot));
+    }
+    catch (...)
+    {
+        if (segment_)
+        {
+            munmap(segment_, segmentSize_);
+        }
+        closeFd(connFd_);
+        closeFd(doorbellFd_);
+        closeFd(notifyFd_);
+        throw;
+    }
+}
+
+TimerShmClient::~TimerShmClient()
+{
+    // Closing the connection tells the daemon to drop our timers and free the slot.
+    closeFd(connFd_);
+    munmap(segment_, segmentSize_);
+    closeFd(doorbellFd_);
+    closeFd(notifyFd_);
+}
+
+bool TimerShmClient::sendRequest(const TimerShmRequest &request)
+{
+    if (!slot_->requests.push(request))
+    {
+        return false;
+    }
+    signalFd(doorbellFd_);
+    return true;
+}
+
+bool TimerShmClient::addTimer(uint64_t timerId, std::function<void()> cb, microseconds interval, microseconds startDelay, TimerPriority priority)
+{
+    if (!cb)
+    {
+        throw std::invalid_argument("TimerShmClient: timer function must be set");
+    }
+    if (interval <= microseconds::zero())
+    {
+        throw std::invalid_argument("TimerShmClient: interval must be positive");
+    }
+    if (startDelay < microseconds::zero())
+    {
+        throw std::invalid_argument("TimerShmClient: start delay must be non-negative");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!timers_.emplace(timerId, Timer{std::move(cb), false}).second)
+    {
+        return false;
+    }
+    const TimerShmRequest request{TimerShmRequest::Add, static_cast<uint32_t>(priority), timerId, interval.count(), startDelay.count()};
+    if (!sendRequest(request))
+    {
+        timers_.erase(timerId);
+        return false;
+    }
+    return true;
+}
+
+bool TimerShmClient::addTimerOnce(uint64_t timerId, std::function<void()> cb, microseconds startDelay, TimerPriority priority)
+{
+    if (!cb)
+    {
+        throw std::invalid_argument("TimerShmClient: timer function must be set");
+    }
+    if (startDelay < microseconds::zero())
+    {
+        throw std::invalid_argument("TimerShmClient: start delay must be non-negative");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!timers_.emplace(timerId, Timer{std::move(cb), true}).second)
+    {
+        return false;
+    }
+    const TimerShmRequest request{TimerShmRequest::AddOnce, static_cast<uint32_t>(priority), timerId, 0, startDelay.count()};
+    if (!sendRequest(request))
+    {
+        timers_.erase(timerId);
+        return false;
+    }
+    return true;
+}
+
+bool TimerShmClient::cancelTimer(uint64_t timerId)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = timers_.find(timerId);
+    if (it == timers_.end())
+    {
+        return false;
+    }
+    const TimerShmRequest request{TimerShmRequest::Cancel, 0, timerId, 0, 0};
+    if (!sendRequest(request))
+    {
+        return false;
+    }
+    timers_.erase(it);
+    return true;
+}
+
+size_t TimerShmClient::dispatch()
+{
+    // Collect the callbacks under the lock, but run them without it, so they may add or cancel timers.
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drainFd(notifyFd_);
+        TimerShmExpiry expiry;
+        while (slot_->expiries.pop(expiry))
+        {
+            auto it = timers_.find(expiry.timerId);
+            if (it == timers_.end())
+            {
+                // Cancelled while the expiry was in flight.
+                continue;
+            }
+            callbacks.push_back(it->second.cb);
+            if (it->second.once)
+            {
+                timers_.erase(it);
+            }
+        }
+    }
+    for (auto &cb : callbacks)
+    {
+        try
+        {
+            cb();
+        }
+        catch (const std::exception &ex)
+        {
+            std::cout << "Error running the shared timer function: " << ex.what() << std::endl;
+        }
+    }
+    return callbacks.size();
+}
+
+size_t TimerShmClient::waitAndDispatch(std::chrono::milliseconds timeout)
+{
+    pollfd fd{notifyFd_, POLLIN, 0};
+    poll(&fd, 1, static_cast<int>(timeout.count()));
+    return dispatch();
+}
+
+uint64_t TimerShmClient::droppedExpiries() const
+{
+    return slot_->droppedExpiries.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,258 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../TimerScheduler/TimerScheduler.h"
+
+/**
+ * A host-local timer service shared by many processes. Instead of every worker process running its own
+ * TimerScheduler thread, one daemon owns the timer queue and the clients talk to it through a shared-memory
+ * segment (shm_open/mmap). E.g.,
+ *
+ *   // in the daemon process
+ *   TimerShmDaemon daemon("housekeeping");
+ *   daemon.start();
+ *
+ *   // in every worker process
+ *   TimerShmClient client("housekeeping");
+ *   client.addTimer(1, [&] { LOG(INFO) << "tick..."; }, seconds(1));
+ *   ........
+ *   poll({client.notifyFd(), POLLIN}, ...); // or any event loop
+ *   client.dispatch();                     // runs the callbacks of expired timers
+ *
+ * Every client gets a slot in the segment with two single-producer/single-consumer lock-free rings: requests
+ * (add/cancel) flow from the client to the daemon, expiries flow back. Each side has an eventfd which the other
+ * side writes to after pushing into a ring. The eventfds are exchanged over a Unix domain socket when the client
+ * registers; the daemon also uses that connection to notice a client going away and drop its timers.
+ *
+ * The daemon runs all timers in one LoopTimerScheduler with interval grouping, so a thousand clients with a 1s
+ * housekeeping timer cost one heap entry and one wakeup per second (timers with a start delay are not grouped, so
+ * the delay is honoured). The daemon can just as well run inside the process of one of the clients (or a test) as a
+ * local stand-in.
+ *
+ * Linux only.
+ */
+
+// A request from a client to the daemon.
+struct TimerShmRequest
+{
+    enum Op : uint32_t
+    {
+        Add = 1,
+        AddOnce = 2,
+        Cancel = 3,
+    };
+
+    uint32_t op;
+    uint32_t priority; // TimerPriority
+    uint64_t timerId;  // Chosen by the client, unique within the client.
+    int64_t intervalUs;
+    int64_t startDelayUs;
+};
+
+// A timer expiry reported by the daemon to a client.
+struct TimerShmExpiry
+{
+    uint64_t timerId;
+    int64_t expiredAtNs; // steady_clock time when the daemon ran the timer.
+};
+
+/**
+ * Bounded single-producer/single-consumer ring that lives in shared memory. It only uses address-free lock-free
+ * atomics and trivially copyable items, so it works across processes that map it at different addresses.
+ */
+template <typename T, uint32_t Capacity>
+struct ShmRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "ShmRing capacity must be a power of two");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmRing needs lock-free 64-bit atomics");
+
+    alignas(64) std::atomic<uint64_t> head; // Next item to pop, written by the consumer.
+    alignas(64) std::atomic<uint64_t> tail; // Next free item, written by the producer.
+    alignas(64) T items[Capacity];
+
+    void reset()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_release);
+    }
+
+    bool push(const T &item)
+    {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+static constexpr uint32_t kTimerShmRingCapacity = 1024;
+
+// Per-client part of the segment.
+struct TimerShmSlot
+{
+    std::atomic<uint32_t> active;           // Set by the daemon while a client owns the slot.
+    std::atomic<uint64_t> droppedExpiries;  // Expiries the daemon could not deliver because the ring was full.
+    ShmRing<TimerShmRequest, kTimerShmRingCapacity> requests;
+    ShmRing<TimerShmExpiry, kTimerShmRingCapacity> expiries;
+};
+
+struct TimerShmHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxClients;
+    uint32_t slotSize;
+};
+
+class TimerShmDaemon
+{
+public:
+    /**
+     * Creates the shared-memory segment and the registration socket for the service called name.
+     * Throws std::system_error on failure.
+     */
+    explicit TimerShmDaemon(const std::string &name, uint32_t maxClients = 64);
+    ~TimerShmDaemon();
+
+    TimerShmDaemon(const TimerShmDaemon &) = delete;
+    TimerShmDaemon &operator=(const TimerShmDaemon &) = delete;
+
+    /**
+     * Starts the daemon thread.
+     * Returns false if the daemon was already running.
+     */
+    bool start();
+
+    /**
+     * Stops the daemon thread. Registered clients stay connected and their timers are kept.
+     * Returns false if the daemon was not running.
+     */
+    bool shutdown();
+
+    // Number of currently registered clients.
+    size_t clientCount();
+
+private:
+    struct Client
+    {
+        int connFd{-1};   // Registration connection, closed by the client when it goes away.
+        int notifyFd{-1}; // The client's eventfd.
+        bool notify{false};
+        std::unordered_set<uint64_t> timers;
+    };
+    // A connection accepted but still waiting for the client's eventfd.
+    struct PendingClient
+    {
+        int connFd;
+        std::chrono::steady_clock::time_point deadline; // Closed if the eventfd hasn't arrived by then.
+    };
+
+    void run();
+    void acceptClient();
+    // Finishes the handshake of a pending connection. Returns false if the eventfd hasn't arrived yet.
+    bool registerClient(int conn);
+    void removeClient(uint32_t slot);
+    void drainRequests(uint32_t slot);
+    void pushExpiry(uint32_t slot, uint64_t timerId);
+    TimerShmSlot &slotAt(uint32_t slot);
+    static std::string timerName(uint32_t slot, uint64_t timerId);
+
+    const std::string name_;
+    const uint32_t maxClients_;
+    size_t segmentSize_{0};
+    void *segment_{nullptr};
+    int listenFd_{-1};
+    int doorbellFd_{-1}; // Written by clients after pushing a request, and by shutdown().
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::mutex mutex_; // Protects clients_ for clientCount(); everything else is only touched by the daemon thread.
+    std::vector<Client> clients_;
+    std::vector<PendingClient> pending_;
+    LoopTimerScheduler scheduler_;
+};
+
+class TimerShmClient
+{
+public:
+    /**
+     * Registers with the daemon of the service called name and maps its segment.
+     * Throws std::system_error if the daemon can't be reached or has no free slot.
+     */
+    explicit TimerShmClient(const std::string &name);
+    ~TimerShmClient();
+
+    TimerShmClient(const TimerShmClient &) = delete;
+    TimerShmClient &operator=(const TimerShmClient &) = delete;
+
+    /**
+     * Asks the daemon to expire timer timerId every interval, starting after startDelay. cb runs in dispatch().
+     * Returns false if timerId is in use or the request ring is full.
+     * Throws std::invalid_argument if interval is not positive or startDelay is negative.
+     */
+    bool addTimer(uint64_t timerId, std::function<void()> cb, std::chrono::microseconds interval,
+                  std::chrono::microseconds startDelay = std::chrono::microseconds(0),
+                  TimerPriority priority = TimerPriority::Normal);
+
+    // Like addTimer(), but the timer expires only once.
+    bool addTimerOnce(uint64_t timerId, std::function<void()> cb, std::chrono::microseconds startDelay,
+                      TimerPriority priority = TimerPriority::Normal);
+
+    // Cancels timerId. Returns false if it does not exist or the request ring is full.
+    bool cancelTimer(uint64_t timerId);
+
+    // eventfd that becomes readable when expiries are waiting. Meant for poll()/epoll.
+    int notifyFd() const { return notifyFd_; }
+
+    // Runs the callbacks of all delivered expiries and returns how many ran.
+    size_t dispatch();
+
+    // Waits up to timeout for expiries, then dispatches them. Returns how many callbacks ran.
+    size_t waitAndDispatch(std::chrono::milliseconds timeout);
+
+    // Expiries the daemon dropped because we did not dispatch fast enough.
+    uint64_t droppedExpiries() const;
+
+private:
+    struct Timer
+    {
+        std::function<void()> cb;
+        bool once;
+    };
+
+    bool sendRequest(const TimerShmRequest &request);
+
+    size_t segmentSize_{0};
+    void *segment_{nullptr};
+    TimerShmSlot *slot_{nullptr};
+    int connFd_{-1};
+    int notifyFd_{-1};
+    int doorbellFd_{-1};
+
+    std::mutex mutex_; // Serializes producers of the request ring and consumers of the expiry ring.
+    std::unordered_map<uint64_t, Timer> timers_;
+};
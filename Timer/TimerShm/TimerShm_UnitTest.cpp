@@ -0,0 +1,345 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include "TimerShm.h"
+
+using namespace std::chrono;
+
+// 每个测试用不同的服务名,避免和并行运行的测试冲突
+static std::string serviceName(const char *test)
+{
+    return std::string(test) + "." + std::to_string(getpid());
+}
+
+// 测试两个客户端共用一个守护进程:周期定时器、一次性定时器和取消
+TEST(TimerShmTest, TwoClients)
+{
+    TimerShmDaemon daemon(serviceName("TwoClients"));
+    ASSERT_TRUE(daemon.start());
+
+    TimerShmClient a(serviceName("TwoClients"));
+    TimerShmClient b(serviceName("TwoClients"));
+    EXPECT_EQ(daemon.clientCount(), 2u);
+
+    int ticksA = 0, ticksB = 0, once = 0, cancelled = 0;
+    EXPECT_TRUE(a.addTimer(1, [&]
+                           { ++ticksA; }, milliseconds(20)));
+    // 不同客户端可以使用相同的timerId
+    EXPECT_TRUE(b.addTimer(1, [&]
+                           { ++ticksB; }, milliseconds(20)));
+    EXPECT_TRUE(b.addTimerOnce(2, [&]
+                               { ++once; }, milliseconds(30)));
+    EXPECT_TRUE(a.addTimerOnce(3, [&]
+                               { ++cancelled; }, milliseconds(80)));
+    // 同一客户端里timerId不能重复
+    EXPECT_FALSE(a.addTimer(1, [] {}, milliseconds(20)));
+    EXPECT_TRUE(a.cancelTimer(3));
+    EXPECT_FALSE(a.cancelTimer(3));
+
+    auto end = steady_clock::now() + milliseconds(200);
+    while (steady_clock::now() < end)
+    {
+        a.waitAndDispatch(milliseconds(10));
+        b.waitAndDispatch(milliseconds(10));
+    }
+
+    EXPECT_GE(ticksA, 4);
+    EXPECT_GE(ticksB, 4);
+    EXPECT_EQ(once, 1);
+    EXPECT_EQ(cancelled, 0);
+    EXPECT_EQ(a.droppedExpiries(), 0u);
+
+    // 取消以后不再回调
+    EXPECT_TRUE(a.cancelTimer(1));
+    std::this_thread::sleep_for(milliseconds(20));
+    a.dispatch();
+    int before = ticksA;
+    std::this_thread::sleep_for(milliseconds(60));
+    a.dispatch();
+    EXPECT_EQ(ticksA, before);
+
+    daemon.shutdown();
+}
+
+// 测试客户端退出后释放槽位,槽位用完时注册失败
+TEST(TimerShmTest, ClientSlots)
+{
+    TimerShmDaemon daemon(serviceName("ClientSlots"), 2);
+    ASSERT_TRUE(daemon.start());
+
+    auto a = std::make_unique<TimerShmClient>(serviceName("ClientSlots"));
+    TimerShmClient b(serviceName("ClientSlots"));
+    EXPECT_TRUE(a->addTimer(1, [] {}, milliseconds(10)));
+    EXPECT_THROW(TimerShmClient c(serviceName("ClientSlots")), std::system_error);
+
+    // 守护进程通过连接断开发现客户端退出
+    a.reset();
+    auto end = steady_clock::now() + seconds(1);
+    while (daemon.clientCount() != 1 && steady_clock::now() < end)
+    {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    EXPECT_EQ(daemon.clientCount(), 1u);
+
+    TimerShmClient c(serviceName("ClientSlots"));
+    EXPECT_EQ(daemon.clientCount(), 2u);
+    // 新客户端拿到的槽位里没有上一个客户端残留的到期通知
+    std::this_thread::sleep_for(milliseconds(30));
+    EXPECT_EQ(c.dispatch(), 0u);
+
+    daemon.shutdown();
+}
+
+// 测试同名的第二个守护进程启动失败,并且不影响正在运行的守护进程
+TEST(TimerShmTest, SecondDaemon)
+{
+    TimerShmDaemon daemon(serviceName("SecondDaemon"));
+    ASSERT_TRUE(daemon.start());
+    EXPECT_THROW(TimerShmDaemon second(serviceName("SecondDaemon")), std::system_error);
+
+    TimerShmClient client(serviceName("SecondDaemon"));
+    int fired = 0;
+    EXPECT_TRUE(client.addTimerOnce(1, [&]
+                                    { ++fired; }, milliseconds(10)));
+    EXPECT_EQ(client.waitAndDispatch(milliseconds(1000)), 1u);
+    EXPECT_EQ(fired, 1);
+    daemon.shutdown();
+}
+
+// 测试周期不大于0的定时器被拒绝,有startDelay的定时器加入已有周期时仍然等满startDelay
+TEST(TimerShmTest, IntervalAndStartDelay)
+{
+    TimerShmDaemon daemon(serviceName("IntervalAndStartDelay"));
+    ASSERT_TRUE(daemon.start());
+    TimerShmClient a(serviceName("IntervalAndStartDelay"));
+    TimerShmClient b(serviceName("IntervalAndStartDelay"));
+
+    EXPECT_THROW(a.addTimer(1, [] {}, microseconds(0)), std::invalid_argument);
+    EXPECT_THROW(a.addTimer(1, [] {}, milliseconds(-1)), std::invalid_argument);
+
+    EXPECT_TRUE(a.addTimer(1, [] {}, milliseconds(100), milliseconds(100)));
+    std::this_thread::sleep_for(milliseconds(150));
+    steady_clock::time_point fired;
+    auto added = steady_clock::now();
+    EXPECT_TRUE(b.addTimer(1, [&]
+                           { fired = steady_clock::now(); }, milliseconds(100), milliseconds(100)));
+    EXPECT_EQ(b.waitAndDispatch(milliseconds(1000)), 1u);
+    EXPECT_GE(fired - added, milliseconds(100));
+    daemon.shutdown();
+}
+
+// 测试没有守护进程时客户端构造失败
+TEST(TimerShmTest, NoDaemon)
+{
+    EXPECT_THROW(TimerShmClient client(serviceName("NoDaemon")), std::system_error);
+}
+
+// 测试通过notifyFd接入自己的事件循环
+TEST(TimerShmTest, NotifyFd)
+{
+    TimerShmDaemon daemon(serviceName("NotifyFd"));
+    ASSERT_TRUE(daemon.start());
+    TimerShmClient client(serviceName("NotifyFd"));
+
+    int fired = 0;
+    auto start = steady_clock::now();
+    EXPECT_TRUE(client.addTimerOnce(1, [&]
+                                    { ++fired; }, milliseconds(50)));
+
+    pollfd fd{client.notifyFd(), POLLIN, 0};
+    ASSERT_EQ(poll(&fd, 1, 1000), 1);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(45));
+    EXPECT_EQ(client.dispatch(), 1u);
+    EXPECT_EQ(fired, 1);
+
+    // 一次性定时器执行后timerId可以重新使用
+    EXPECT_TRUE(client.addTimerOnce(1, [&]
+                                    { ++fired; }, milliseconds(10)));
+    EXPECT_EQ(client.waitAndDispatch(milliseconds(1000)), 1u);
+    EXPECT_EQ(fired, 2);
+
+    daemon.shutdown();
+}
+
+// 在子进程里注册客户端：一直重试到守护进程启动，收到ticks次到期通知后把次数写进pipe
+static void runForkedClient(const std::string &name, int pipeFd, int ticks)
+{
+    std::unique_ptr<TimerShmClient> client;
+    auto end = steady_clock::now() + seconds(5);
+    while (!client && steady_clock::now() < end)
+    {
+        try
+        {
+            client = std::make_unique<TimerShmClient>(name);
+        }
+        catch (const std::system_error &)
+        {
+            std::this_thread::sleep_for(milliseconds(5));
+        }
+    }
+    if (!client)
+    {
+        _exit(2);
+    }
+    int fired = 0;
+    if (!client->addTimer(1, [&]
+                          { ++fired; }, milliseconds(10)))
+    {
+        _exit(3);
+    }
+    while (fired < ticks && steady_clock::now() < end)
+    {
+        client->waitAndDispatch(milliseconds(100));
+    }
+    (void)!write(pipeFd, &fired, sizeof(fired));
+}
+
+// 测试跨进程：子进程映射到自己的地址上、通过SCM_RIGHTS交换eventfd收到到期通知，
+// 然后被SIGKILL杀掉，守护进程要发现连接断开并回收槽位和定时器
+TEST(TimerShmTest, ForkedClient)
+{
+    const std::string name = serviceName("ForkedClient");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    // 先fork再创建守护进程，子进程里没有守护进程的线程和状态
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        close(fds[0]);
+        runForkedClient(name, fds[1], 3);
+        // 不正常退出：不执行析构函数，连接由内核关闭
+        raise(SIGKILL);
+        _exit(4);
+    }
+    close(fds[1]);
+
+    TimerShmDaemon daemon(name, 1);
+    ASSERT_TRUE(daemon.start());
+
+    pollfd fd{fds[0], POLLIN, 0};
+    int fired = 0;
+    ASSERT_EQ(poll(&fd, 1, 5000), 1);
+    ASSERT_EQ(read(fds[0], &fired, sizeof(fired)), static_cast<ssize_t>(sizeof(fired)));
+    close(fds[0]);
+    EXPECT_GE(fired, 3);
+
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    auto end = steady_clock::now() + seconds(1);
+    while (daemon.clientCount() != 0 && steady_clock::now() < end)
+    {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    EXPECT_EQ(daemon.clientCount(), 0u);
+
+    // 唯一的槽位可以重新使用，子进程的周期定时器已经取消，不会再有它的到期通知
+    TimerShmClient client(name);
+    std::this_thread::sleep_for(milliseconds(30));
+    EXPECT_EQ(client.dispatch(), 0u);
+    int once = 0;
+    EXPECT_TRUE(client.addTimerOnce(2, [&]
+                                    { ++once; }, milliseconds(10)));
+    EXPECT_EQ(client.waitAndDispatch(milliseconds(1000)), 1u);
+    EXPECT_EQ(once, 1);
+    daemon.shutdown();
+}
+
+// 按守护进程的方式连上注册用的抽象套接字，但不发送eventfd
+static int connectRaw(const std::string &name)
+{
+    const std::string path = "timershm." + name;
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path + 1, path.data(), path.size());
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + path.size())) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 测试连上以后迟迟不注册的客户端不会卡住守护进程线程，超时以后连接被关闭
+TEST(TimerShmTest, StalledRegistration)
+{
+    TimerShmDaemon daemon(serviceName("StalledRegistration"));
+    ASSERT_TRUE(daemon.start());
+    const int stalled = connectRaw(serviceName("StalledRegistration"));
+    ASSERT_GE(stalled, 0);
+    std::this_thread::sleep_for(milliseconds(20));
+
+    auto start = steady_clock::now();
+    TimerShmClient client(serviceName("StalledRegistration"));
+    int fired = 0;
+    EXPECT_TRUE(client.addTimerOnce(1, [&]
+                                    { ++fired; }, milliseconds(10)));
+    EXPECT_EQ(client.waitAndDispatch(milliseconds(1000)), 1u);
+    EXPECT_LT(steady_clock::now() - start, milliseconds(500));
+    EXPECT_EQ(daemon.clientCount(), 1u);
+
+    pollfd fd{stalled, POLLIN, 0};
+    ASSERT_EQ(poll(&fd, 1, 3000), 1);
+    EXPECT_TRUE(fd.revents & (POLLHUP | POLLIN));
+    char byte;
+    EXPECT_EQ(recv(stalled, &byte, sizeof(byte), 0), 0);
+    close(stalled);
+    daemon.shutdown();
+}
+
+// 测试其他用户的进程不能注册（需要root权限才能切换用户）
+TEST(TimerShmTest, OtherUser)
+{
+    if (geteuid() != 0)
+    {
+        GTEST_SKIP();
+    }
+    TimerShmDaemon daemon(serviceName("OtherUser"));
+    ASSERT_TRUE(daemon.start());
+
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        if (setuid(65534) != 0)
+        {
+            _exit(2);
+        }
+        try
+        {
+            TimerShmClient client(serviceName("OtherUser"));
+        }
+        catch (const std::system_error &)
+        {
+            _exit(0);
+        }
+        _exit(1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(daemon.clientCount(), 0u);
+    daemon.shutdown();
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    int status = RUN_ALL_TESTS();
+    return 0;
+}